@@ -7,6 +7,16 @@
 
 #include "Database.h"
 
+#include <chrono>
+#include <climits>
+#include <cstring>
+
+#ifdef Q_OS_WIN32
+#include <winsock2.h>
+#else
+#include <poll.h>
+#endif
+
 namespace JDB {
 
 MySQLODBCController::MySQLODBCController() {
@@ -188,6 +198,241 @@ QPair<int, QList<QList<QVariant>>> MySQLODBCController::modify(
     return this->runsql(sql_cmd);
 }
 
+bool RedisReplyView::isAggregate() const {
+    switch (this->type()) {
+        case RedisDataType::Array:
+        case RedisDataType::Map:
+        case RedisDataType::Set:
+        case RedisDataType::Attr:
+        case RedisDataType::Push:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool RedisReplyView::equals(const char* text) const {
+    size_t size = std::strlen(text);
+    return this->length() == (qint64)size &&
+           std::memcmp(this->data(), text, size) == 0;
+}
+
+const char* RedisReplyView::data() const {
+    return this->reply != nullptr ? this->reply->str : nullptr;
+}
+
+qint64 RedisReplyView::length() const {
+    return this->data() != nullptr ? this->reply->len : 0;
+}
+
+qint64 RedisReplyView::integer() const {
+    switch (this->type()) {
+        case RedisDataType::Integer:
+        case RedisDataType::Bool:
+            return this->reply->integer;
+        case RedisDataType::Double:
+            return (qint64)this->reply->dval;
+        case RedisDataType::String:
+        case RedisDataType::Status:
+        case RedisDataType::Verb:
+        case RedisDataType::Bignum:
+            return this->bytes().toLongLong();
+        default:
+            return 0;
+    }
+}
+
+double RedisReplyView::real() const {
+    switch (this->type()) {
+        case RedisDataType::Integer:
+        case RedisDataType::Bool:
+            return this->reply->integer;
+        case RedisDataType::Double:
+            return this->reply->dval;
+        case RedisDataType::String:
+        case RedisDataType::Status:
+        case RedisDataType::Verb:
+        case RedisDataType::Bignum:
+            return this->bytes().toDouble();
+        default:
+            return 0;
+    }
+}
+
+QVariant RedisReplyView::value() const {
+    switch (this->type()) {
+        case RedisDataType::String:
+        case RedisDataType::Status:
+        case RedisDataType::Error:
+        case RedisDataType::Verb:
+        case RedisDataType::Bignum:
+            return this->string();
+        case RedisDataType::Integer:
+            return this->reply->integer;
+        case RedisDataType::Double:
+            return this->reply->dval;
+        case RedisDataType::Bool:
+            return this->reply->integer != 0;
+        default:
+            break;
+    }
+    if (!this->isAggregate()) {
+        return QVariant();
+    }
+    QList<QVariant> ret;
+    ret.reserve(this->size());
+    for (RedisReplyView element : *this) {
+        ret.push_back(element.value());
+    }
+    return ret;
+}
+
+static QList<QVariant> reply_data(const RedisReplyView& reply) {
+    QList<QVariant> ret;
+    switch (reply.type()) {
+        case RedisDataType::Nil:
+            break;
+        case RedisDataType::Integer:
+        case RedisDataType::Double:
+        case RedisDataType::Bool:
+            ret.push_back(reply.value());
+            break;
+        default:
+            if (!reply.isAggregate()) {
+                ret.push_back(reply.string());
+            }
+            for (RedisReplyView element : reply) {
+                ret.push_back(reply_data(element));
+            }
+            break;
+    }
+    return ret;
+}
+
+QList<QVariant> RedisReply::getData() const {
+    return reply_data(this->view());
+}
+
+RedisCommand& RedisCommand::operator<<(const char* arg) {
+    this->args.push_back(QByteArray(arg));
+    return *this;
+}
+
+RedisCommand& RedisCommand::operator<<(const QByteArray& arg) {
+    this->args.push_back(arg);
+    return *this;
+}
+
+RedisCommand& RedisCommand::operator<<(const QString& arg) {
+    this->args.push_back(arg.toUtf8());
+    return *this;
+}
+
+RedisCommand& RedisCommand::operator<<(const QVariant& arg) {
+    this->args.push_back(arg.type() == QVariant::ByteArray
+                             ? arg.toByteArray()
+                             : arg.toString().toUtf8());
+    return *this;
+}
+
+RedisCommand& RedisCommand::operator<<(const QList<QString>& args) {
+    for (const QString& arg : args) {
+        this->args.push_back(arg.toUtf8());
+    }
+    return *this;
+}
+
+void RedisCommand::prepare(std::vector<const char*>& argv,
+                           std::vector<size_t>& argvlen) const {
+    argv.resize(this->args.size());
+    argvlen.resize(this->args.size());
+    for (int i = 0; i < this->args.size(); ++i) {
+        argv[i] = this->args[i].constData();
+        argvlen[i] = this->args[i].size();
+    }
+}
+
+RedisPipeline::RedisPipeline(RedisController& controller, bool transaction)
+    : controller(controller), transaction(transaction) {}
+
+RedisPipeline& RedisPipeline::operator<<(const RedisCommand& cmd) {
+    return this->add(cmd);
+}
+
+RedisPipeline& RedisPipeline::add(const RedisCommand& cmd) {
+    this->commands.push_back(cmd);
+    return *this;
+}
+
+void RedisPipeline::clear() {
+    this->commands.clear();
+    this->types.clear();
+    this->results.clear();
+}
+
+bool RedisPipeline::exec() {
+    this->types.clear();
+    this->results.clear();
+    if (this->commands.isEmpty()) return true;
+
+    QList<RedisCommand> cmds;
+    if (this->transaction) {
+        cmds.push_back(RedisCommand("multi"));
+        cmds.append(this->commands);
+        cmds.push_back(RedisCommand("exec"));
+    } else {
+        cmds = this->commands;
+    }
+    QList<RedisReply> replies = this->controller.runpipeline(cmds);
+    bool completed = replies.size() == cmds.size();
+    if (this->transaction) {
+        RedisReplyView exec_reply =
+            completed ? replies.back().view() : RedisReplyView();
+        if (exec_reply.type() == RedisDataType::Array) {
+            for (RedisReplyView reply : exec_reply) {
+                this->types.push_back(reply.type());
+                this->results.push_back(reply_data(reply));
+            }
+        }
+        completed = this->results.size() == this->commands.size();
+    } else {
+        for (const RedisReply& reply : replies) {
+            this->types.push_back(reply.getType());
+            this->results.push_back(reply.getData());
+        }
+    }
+    return completed;
+}
+
+RedisDataType RedisPipeline::type(int index) const {
+    return this->types.value(index, RedisDataType::Nil);
+}
+
+bool RedisPipeline::isError(int index) const {
+    return this->type(index) == RedisDataType::Error;
+}
+
+bool RedisPipeline::ok(int index) const {
+    return this->type(index) == RedisDataType::Status &&
+           this->value(index).toString() == "OK";
+}
+
+QList<QVariant> RedisPipeline::data(int index) const {
+    return this->results.value(index);
+}
+
+QVariant RedisPipeline::value(int index) const {
+    return this->results.value(index).value(0);
+}
+
+QString RedisPipeline::string(int index) const {
+    return this->value(index).toString();
+}
+
+qint64 RedisPipeline::integer(int index) const {
+    return this->value(index).toLongLong();
+}
+
 RedisController::RedisController() {}
 
 RedisController::RedisController(QString host, quint16 port, QString user,
@@ -206,8 +451,36 @@ void RedisController::setAuth(QString user, QString pass) {
     this->pass = pass;
 }
 
+void RedisController::setCache(qint64 max_bytes) {
+    this->lock.lock();
+    this->cache_max_bytes = qMax(max_bytes, (qint64)0);
+    this->cache.setMaxCost((int)qMin(this->cache_max_bytes, (qint64)INT_MAX));
+    bool stop = this->cache_max_bytes == 0 && this->tracking.load();
+    bool start = this->cache_max_bytes > 0 && !this->tracking.load();
+    this->lock.unlock();
+    if (stop) {
+        this->stop_tracking();
+    } else if (start && this->getConnected()) {
+        this->start_tracking();
+    }
+}
+
 bool RedisController::getConnected() { return this->database != nullptr; }
 
+bool RedisController::getFailed() {
+    return this->database == nullptr || this->database->err != 0;
+}
+
+bool RedisController::getCaching() { return this->tracking.load(); }
+
+RedisCacheStats RedisController::getCacheStats() {
+    QMutexLocker guard(&this->lock);
+    RedisCacheStats stats = this->cache_stats;
+    stats.entries = this->cache.count();
+    stats.bytes = this->cache.totalCost();
+    return stats;
+}
+
 void RedisController::connect() {
     if (this->database == nullptr) {
         this->database =
@@ -217,13 +490,19 @@ void RedisController::connect() {
             return;
         }
         if (!this->pass.isEmpty()) {
-            if (this->data_from_reply(this->runredis(
-                    QString("auth %1 %2").arg(this->user).arg(this->pass)))[0]
-                    .toString() != "OK") {
+            RedisCommand cmd("auth");
+            if (!this->user.isEmpty()) {
+                cmd << this->user;
+            }
+            cmd << this->pass;
+            if (!this->runredis(cmd).view().equals("OK")) {
                 this->disconnect();
                 return;
             }
         }
+        if (this->cache_max_bytes > 0) {
+            this->start_tracking();
+        }
     } else {
         this->disconnect();
         this->connect();
@@ -235,6 +514,10 @@ void RedisController::disconnect() {
         redisFree(this->database);
         this->database = nullptr;
     }
+    this->db = 0;
+    this->tracking.store(false);
+    this->cache.clear();
+    this->invalidations.reset();
 }
 
 RedisReply RedisController::runredis(QString cmd) {
@@ -250,388 +533,1555 @@ RedisReply RedisController::runredis(QString cmd) {
     return reply;
 }
 
+RedisReply RedisController::runredis(const RedisCommand& cmd) {
+    if (!this->lock.tryLock()) {
+        throw "cannot get lock";
+    }
+    RedisReply reply = this->execute(cmd);
+    this->lock.unlock();
+    return reply;
+}
+
+RedisReply RedisController::execute(const RedisCommand& cmd) {
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    cmd.prepare(argv, argvlen);
+    RedisReply reply;
+    if (this->getConnected()) {
+        reply = (redisReply*)redisCommandArgv(this->database, argv.size(),
+                                              argv.data(), argvlen.data());
+    }
+    return reply;
+}
+
+QVariant RedisController::cached(const RedisCommand& cmd,
+                                 const QByteArray& key,
+                                 const QByteArray* field) {
+    if (!this->tracking.load()) {
+        return this->runredis(cmd).view().value();
+    }
+    if (!this->lock.tryLock()) {
+        throw "cannot get lock";
+    }
+    this->read_invalidations();
+    CacheEntry* entry = this->cache.object(key);
+    if (entry != nullptr && field == nullptr && entry->has_value) {
+        this->cache_stats.hits += 1;
+        QVariant value = entry->value.value;
+        this->lock.unlock();
+        return value;
+    }
+    if (entry != nullptr && field != nullptr &&
+        entry->fields.contains(*field)) {
+        this->cache_stats.hits += 1;
+        QVariant value = entry->fields.value(*field).value;
+        this->lock.unlock();
+        return value;
+    }
+    this->cache_stats.misses += 1;
+    RedisReply reply = this->execute(cmd);
+    RedisReplyView view = reply.view();
+    QVariant value = view.value();
+    if (this->tracking.load() && view.isValid() && !view.isError()) {
+        entry = this->cache.take(key);
+        if (entry == nullptr) {
+            entry = new CacheEntry();
+            entry->bytes = key.size() + sizeof(CacheEntry);
+        }
+        CachedValue cached;
+        cached.value = value;
+        cached.bytes = view.length() + sizeof(CachedValue);
+        if (field == nullptr) {
+            if (entry->has_value) entry->bytes -= entry->value.bytes;
+            entry->value = cached;
+            entry->has_value = true;
+        } else {
+            cached.bytes += field->size();
+            QHash<QByteArray, CachedValue>::iterator it =
+                entry->fields.find(*field);
+            if (it != entry->fields.end()) entry->bytes -= it.value().bytes;
+            entry->fields.insert(*field, cached);
+        }
+        entry->bytes += cached.bytes;
+        this->cache.insert(key, entry,
+                           (int)qMin(entry->bytes, (qint64)INT_MAX));
+    }
+    this->lock.unlock();
+    return value;
+}
+
+bool RedisController::start_tracking() {
+    this->stop_tracking();
+    std::unique_ptr<RedisController> link(
+        new RedisController(this->host, this->port, this->user, this->pass));
+    link->connect();
+    qint64 id = link->runredis(RedisCommand("client") << "id").view().integer();
+    RedisReply subscribed =
+        link->runredis(RedisCommand("subscribe") << "__redis__:invalidate");
+    if (id <= 0 || !subscribed.view().isAggregate()) {
+        return false;
+    }
+    bool enabled = this->runredis(RedisCommand("client") << "tracking"
+                                                         << "on"
+                                                         << "redirect" << id)
+                       .view()
+                       .equals("OK");
+    this->lock.lock();
+    this->cache.clear();
+    if (enabled) {
+        this->invalidations = std::move(link);
+    }
+    this->tracking.store(enabled);
+    this->lock.unlock();
+    return enabled;
+}
+
+void RedisController::stop_tracking() {
+    this->lock.lock();
+    bool tracked = this->invalidations != nullptr;
+    this->tracking.store(false);
+    this->cache.clear();
+    std::unique_ptr<RedisController> link = std::move(this->invalidations);
+    this->lock.unlock();
+    if (tracked && this->getConnected()) {
+        this->runredis(RedisCommand("client") << "tracking" << "off");
+    }
+}
+
+void RedisController::read_invalidations() {
+    RedisController* link = this->invalidations.get();
+    if (link == nullptr || link->getFailed()) {
+        this->tracking.store(false);
+        this->cache.clear();
+        return;
+    }
+    // the tracking connection only receives invalidation messages, so poll
+    // it for any that were sent since the last command before trusting the
+    // cache.
+    redisContext* context = link->database;
+    forever {
+#ifdef Q_OS_WIN32
+        WSAPOLLFD fd = {(SOCKET)context->fd, POLLIN, 0};
+        if (WSAPoll(&fd, 1, 0) <= 0) {
+            return;
+        }
+#else
+        struct pollfd fd = {context->fd, POLLIN, 0};
+        if (poll(&fd, 1, 0) <= 0) {
+            return;
+        }
+#endif
+        if (redisBufferRead(context) != REDIS_OK) {
+            this->tracking.store(false);
+            this->cache.clear();
+            return;
+        }
+        void* reply = nullptr;
+        while (redisGetReplyFromReader(context, &reply) == REDIS_OK &&
+               reply != nullptr) {
+            this->invalidate(RedisReplyView((redisReply*)reply));
+            freeReplyObject(reply);
+            reply = nullptr;
+        }
+    }
+}
+
+void RedisController::invalidate(const RedisReplyView& message) {
+    if (message.size() < 3 || !message[0].equals("message")) {
+        return;
+    }
+    RedisReplyView keys = message[2];
+    if (!keys.isAggregate()) {
+        this->cache.clear();
+        this->cache_stats.flushes += 1;
+        return;
+    }
+    for (RedisReplyView key : keys) {
+        if (this->cache.remove(key.bytes())) {
+            this->cache_stats.invalidations += 1;
+        }
+    }
+}
+
+QList<RedisReply> RedisController::runpipeline(
+    const QList<RedisCommand>& cmds) {
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    if (!this->lock.tryLock()) {
+        throw "cannot get lock";
+    }
+    QList<RedisReply> replies;
+    if (this->getConnected()) {
+        int queued = 0;
+        for (const RedisCommand& cmd : cmds) {
+            cmd.prepare(argv, argvlen);
+            if (redisAppendCommandArgv(this->database, argv.size(), argv.data(),
+                                       argvlen.data()) != REDIS_OK) {
+                break;
+            }
+            ++queued;
+        }
+        for (int i = 0; i < queued; ++i) {
+            void* reply = nullptr;
+            if (redisGetReply(this->database, &reply) != REDIS_OK) break;
+            replies.push_back((redisReply*)reply);
+        }
+    }
+    this->lock.unlock();
+    return replies;
+}
+
 bool RedisController::ping() {
-    return this->data_from_reply(this->runredis("ping"))[0].toString() ==
-           "PONG";
+    return this->runredis(RedisCommand("ping")).view().equals("PONG");
 }
 
 QVariant RedisController::get(QString key) {
-    QList<QVariant> data =
-        this->data_from_reply(this->runredis(QString("get %1").arg(key)));
-    return data.size() == 0 ? QVariant() : data[0];
+    return this->cached(RedisCommand("get") << key, key.toUtf8(), nullptr);
 }
 
 bool RedisController::set(QString key, QVariant value, qint64 expire) {
-    return this->data_from_reply(this->runredis(
-               QString("set %1 %2 %3")
-                   .arg(key)
-                   .arg(value.toString())
-                   .arg(expire > 0 ? (" ex " + QString::number(expire))
-                                   : "")))[0]
-               .toString() == "OK";
+    RedisCommand cmd("set");
+    cmd << key << value;
+    if (expire > 0) {
+        cmd << "ex" << expire;
+    }
+    return this->runredis(cmd).view().equals("OK");
+}
+
+QList<QVariant> RedisController::mget(QList<QString> keys) {
+    QList<RedisCommand> cmds;
+    for (int i = 0; i < keys.size(); i += REDIS_BULK_CHUNK) {
+        cmds.push_back(RedisCommand("mget") << keys.mid(i, REDIS_BULK_CHUNK));
+    }
+    QList<RedisReply> replies = this->runpipeline(cmds);
+    QList<QVariant> ret;
+    ret.reserve(keys.size());
+    for (int i = 0; i < keys.size(); ++i) {
+        ret.push_back(replies.value(i / REDIS_BULK_CHUNK)
+                          .view()[i % REDIS_BULK_CHUNK]
+                          .value());
+    }
+    return ret;
+}
+
+bool RedisController::mset(QHash<QString, QVariant> data) {
+    QList<RedisCommand> cmds;
+    int pairs = 0;
+    for (QHash<QString, QVariant>::iterator it = data.begin(); it != data.end();
+         ++it) {
+        if (pairs % REDIS_BULK_CHUNK == 0) {
+            cmds.push_back(RedisCommand("mset"));
+        }
+        cmds.back() << it.key() << it.value();
+        pairs += 1;
+    }
+    QList<RedisReply> replies = this->runpipeline(cmds);
+    bool ret = replies.size() == cmds.size();
+    for (const RedisReply& reply : replies) {
+        ret = ret && reply.view().equals("OK");
+    }
+    return ret;
 }
 
 bool RedisController::select(quint16 db) {
-    return this->data_from_reply(
-                   this->runredis(QString("select %1").arg(db)))[0]
-               .toString() == "OK";
+    // invalidations carry no database, so cached keys only hold for one db.
+    bool selected =
+        this->runredis(RedisCommand("select") << db).view().equals("OK");
+    if (selected) {
+        this->db = db;
+    }
+    if (selected && this->tracking.load()) {
+        QMutexLocker guard(&this->lock);
+        this->cache.clear();
+    }
+    return selected;
 }
 
 qint64 RedisController::dbsize() {
-    return this->data_from_reply(this->runredis(QString("dbsize")))[0].toInt();
+    return this->runredis(RedisCommand("dbsize")).view().integer();
 }
 
 bool RedisController::flushdb() {
-    return this->data_from_reply(this->runredis(QString("flushdb")))[0]
-               .toString() == "OK";
+    return this->runredis(RedisCommand("flushdb")).view().equals("OK");
 }
 
 bool RedisController::flushall() {
-    return this->data_from_reply(this->runredis(QString("flushall")))[0]
-               .toString() == "OK";
+    return this->runredis(RedisCommand("flushall")).view().equals("OK");
 }
 
 QList<QString> RedisController::keys(QString match) {
-    QList<QVariant> data =
-        this->data_from_reply(this->runredis(QString("keys %1").arg(match)));
+    QSet<QString> seen;
     QList<QString> ret;
-    if (!data.empty() && data[0].type() == QVariant::List) {
-        for (QVariant& item : data[0].toList()) {
-            ret.push_back(item.toString());
+    for (const RedisScanItem& item : this->scanKeys(match, 1000)) {
+        if (!seen.contains(item.key)) {
+            seen.insert(item.key);
+            ret.push_back(item.key);
         }
     }
     return ret;
 }
 
 bool RedisController::exists(QString key) {
-    return this
-        ->data_from_reply(this->runredis(QString("exists %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("exists") << key).view().integer();
 }
 
 quint64 RedisController::del(QList<QString> keys) {
-    return this
-        ->data_from_reply(
-            this->runredis(QString("del %1").arg(keys.join(' '))))[0]
-        .toInt();
+    return this->run_keys("del", keys);
+}
+
+quint64 RedisController::unlink(QList<QString> keys) {
+    return this->run_keys("unlink", keys);
+}
+
+quint64 RedisController::run_keys(const char* name,
+                                  const QList<QString>& keys) {
+    if (keys.isEmpty()) return 0;
+    QList<RedisCommand> cmds;
+    for (int i = 0; i < keys.size(); i += REDIS_BULK_CHUNK) {
+        cmds.push_back(RedisCommand(name) << keys.mid(i, REDIS_BULK_CHUNK));
+    }
+    quint64 ret = 0;
+    for (const RedisReply& reply : this->runpipeline(cmds)) {
+        ret += reply.view().integer();
+    }
+    return ret;
 }
 
 bool RedisController::move(QString key, quint16 db) {
-    return this->data_from_reply(
-                   this->runredis(QString("move %1 %2").arg(key).arg(db)))[0]
-               .toString() == "1";
+    return this->runredis(RedisCommand("move") << key << db).view().integer();
 }
 
 RedisDataType RedisController::type(QString key) {
-    QString data =
-        this->data_from_reply(this->runredis(QString("type %1").arg(key)))[0]
-            .toString();
+    QString data = this->runredis(RedisCommand("type") << key).view().string();
     return REDIS_TYPE_MAP.contains(data) ? REDIS_TYPE_MAP[data]
                                          : RedisDataType::Nil;
 }
 
 bool RedisController::expire(QString key, qint64 seconds) {
-    return this->data_from_reply(this->runredis(
-               QString("expire %1 %2").arg(key).arg(seconds)))[0]
-               .toString() == "1";
+    return this->runredis(RedisCommand("expire") << key << seconds)
+        .view()
+        .integer();
 }
 
 bool RedisController::pexpire(QString key, qint64 seconds) {
-    return this->data_from_reply(this->runredis(
-               QString("pexpire %1 %2").arg(key).arg(seconds)))[0]
-               .toString() == "1";
+    return this->runredis(RedisCommand("pexpire") << key << seconds)
+        .view()
+        .integer();
 }
 
 qint64 RedisController::ttl(QString key) {
-    return this->data_from_reply(this->runredis(QString("ttl %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("ttl") << key).view().integer();
 }
 
 qint64 RedisController::pttl(QString key) {
-    return this->data_from_reply(this->runredis(QString("pttl %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("pttl") << key).view().integer();
 }
 
 bool RedisController::persist(QString key) {
-    return this
-        ->data_from_reply(this->runredis(QString("persist %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("persist") << key).view().integer();
 }
 
 QPair<qint64, QList<QString>> RedisController::scan(QString match, qint64 count,
                                                     qint64 cursor) {
-    QList<QVariant> data = this->data_from_reply(this->runredis(
-        QString("scan %1 %2 %3")
-            .arg(cursor)
-            .arg(match.isEmpty() ? "" : ("match " + match))
-            .arg(count > 0 ? QString("count %1").arg(count) : "")));
+    RedisCommand cmd("scan");
+    cmd << QByteArray::number((quint64)cursor);
+    if (!match.isEmpty()) {
+        cmd << "match" << match;
+    }
+    if (count > 0) {
+        cmd << "count" << count;
+    }
+    RedisReply reply = this->runredis(cmd);
+    RedisReplyView data = reply.view();
     QPair<qint64, QList<QString>> ret;
     if (data.size() > 1) {
-        ret.first = data[0].toList()[0].toInt();
-        for (QVariant& item : data[1].toList()) {
-            ret.second.push_back(item.toList()[0].toString());
+        ret.first = (qint64)data[0].bytes().toULongLong();
+        ret.second.reserve(data[1].size());
+        for (RedisReplyView item : data[1]) {
+            ret.second.push_back(item.string());
         }
     }
     return ret;
 }
 
+RedisScan RedisController::scanKeys(QString match, qint64 count, QString type,
+                                    bool prefetch) {
+    return RedisScan(*this, RedisDataType::Nil, "", match, count, type,
+                     prefetch);
+}
+
+RedisScan RedisController::hscan(QString key, QString match, qint64 count,
+                                 bool prefetch) {
+    return RedisScan(*this, RedisDataType::Hash, key, match, count, "",
+                     prefetch);
+}
+
+RedisScan RedisController::sscan(QString key, QString match, qint64 count,
+                                 bool prefetch) {
+    return RedisScan(*this, RedisDataType::Set, key, match, count, "",
+                     prefetch);
+}
+
+RedisScan RedisController::zscan(QString key, QString match, qint64 count,
+                                 bool prefetch) {
+    return RedisScan(*this, RedisDataType::ZSet, key, match, count, "",
+                     prefetch);
+}
+
 bool RedisController::setnx(QString key, QVariant value) {
-    return this
-        ->data_from_reply(this->runredis(
-            QString("setnx %1 %2").arg(key).arg(value.toString())))[0]
-        .toInt();
+    return this->runredis(RedisCommand("setnx") << key << value)
+        .view()
+        .integer();
 }
 
 QVariant RedisController::getset(QString key, QVariant value) {
-    QList<QVariant> data = this->data_from_reply(
-        this->runredis(QString("getset %1 %2").arg(key).arg(value.toString())));
-    return (data.size() == 0 ? QVariant() : data[0]);
+    return this->runredis(RedisCommand("getset") << key << value)
+        .view()
+        .value();
 }
 
 qint64 RedisController::append(QString key, QVariant value) {
-    return this
-        ->data_from_reply(this->runredis(
-            QString("append %1 %2").arg(key).arg(value.toString())))[0]
-        .toInt();
+    return this->runredis(RedisCommand("append") << key << value)
+        .view()
+        .integer();
 }
 
 qint64 RedisController::incr(QString key) {
-    return this->data_from_reply(this->runredis(QString("incr %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("incr") << key).view().integer();
 }
 
 qint64 RedisController::decr(QString key) {
-    return this->data_from_reply(this->runredis(QString("decr %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("decr") << key).view().integer();
 }
 
 qint64 RedisController::incrby(QString key, qint64 value) {
-    return this
-        ->data_from_reply(
-            this->runredis(QString("incrby %1 %2").arg(key).arg(value)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("incrby") << key << value)
+        .view()
+        .integer();
 }
 
 qint64 RedisController::decrby(QString key, qint64 value) {
-    return this
-        ->data_from_reply(
-            this->runredis(QString("decrby %1 %2").arg(key).arg(value)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("decrby") << key << value)
+        .view()
+        .integer();
 }
 
 float RedisController::incrbyfloat(QString key, float value) {
-    return this
-        ->data_from_reply(
-            this->runredis(QString("incrbyfloat %1 %2").arg(key).arg(value)))[0]
-        .toFloat();
+    return this->runredis(RedisCommand("incrbyfloat") << key << value)
+        .view()
+        .real();
 }
 
 qint64 RedisController::strlen(QString key) {
-    return this
-        ->data_from_reply(this->runredis(QString("strlen %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("strlen") << key).view().integer();
 }
 
 QString RedisController::getrange(QString key, qint64 start, qint64 end) {
-    return this
-        ->data_from_reply(this->runredis(
-            QString("getrange %1 %2 %3").arg(key).arg(start).arg(end)))[0]
-        .toString();
+    return this->runredis(RedisCommand("getrange") << key << start << end)
+        .view()
+        .string();
 }
 
 qint64 RedisController::setrange(QString key, qint64 offset, QString value) {
-    return this
-        ->data_from_reply(this->runredis(
-            QString("setrange %1 %2 %3").arg(key).arg(offset).arg(value)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("setrange") << key << offset << value)
+        .view()
+        .integer();
 }
 
 bool RedisController::hset(QString key, QString hkey, QVariant hvalue) {
-    return this
-        ->data_from_reply(this->runredis(QString("hset %1 %2 %3")
-                                             .arg(key)
-                                             .arg(hkey)
-                                             .arg(hvalue.toString())))[0]
-        .toInt();
+    return this->runredis(RedisCommand("hset") << key << hkey << hvalue)
+        .view()
+        .integer();
+}
+
+qint64 RedisController::hset(QString key, QHash<QString, QVariant> data) {
+    QList<RedisCommand> cmds;
+    int pairs = 0;
+    for (QHash<QString, QVariant>::iterator it = data.begin(); it != data.end();
+         ++it) {
+        if (pairs % REDIS_BULK_CHUNK == 0) {
+            cmds.push_back(RedisCommand("hset") << key);
+        }
+        cmds.back() << it.key() << it.value();
+        pairs += 1;
+    }
+    qint64 ret = 0;
+    for (const RedisReply& reply : this->runpipeline(cmds)) {
+        ret += reply.view().integer();
+    }
+    return ret;
 }
 
 bool RedisController::hmset(QString key, QHash<QString, QVariant> data) {
-    QString cmd = QString("hmset %1").arg(key);
+    RedisCommand cmd("hmset");
+    cmd << key;
     for (QHash<QString, QVariant>::iterator it = data.begin(); it != data.end();
          ++it) {
-        cmd += QString(" %1 %2").arg(it.key()).arg(it.value().toString());
+        cmd << it.key() << it.value();
     }
-    return this->data_from_reply(this->runredis(cmd))[0].toString() == "OK";
+    return this->runredis(cmd).view().equals("OK");
 }
 
 QVariant RedisController::hget(QString key, QString hkey) {
-    return this->data_from_reply(
-        this->runredis(QString("hget %1 %2").arg(key).arg(hkey)))[0];
+    QByteArray field = hkey.toUtf8();
+    return this->cached(RedisCommand("hget") << key << field, key.toUtf8(),
+                        &field);
 }
 
-QList<QVariant> RedisController::hmget(QString key, QList<QString> hkeys) {
-    QList<QVariant> data = this->data_from_reply(
-        this->runredis(QString("hmget %1 %2").arg(key).arg(hkeys.join(' '))));
+static QList<QVariant> reply_values(const RedisReplyView& reply) {
     QList<QVariant> ret;
-    for (QVariant& item : data) {
-        if (item.type() == QVariant::List) {
-            ret.push_back(item.toList()[0]);
-        }
+    ret.reserve(reply.size());
+    for (RedisReplyView item : reply) {
+        ret.push_back(item.value());
     }
     return ret;
 }
 
+QList<QVariant> RedisController::hmget(QString key, QList<QString> hkeys) {
+    return reply_values(
+        this->runredis(RedisCommand("hmget") << key << hkeys).view());
+}
+
 QHash<QString, QVariant> RedisController::hgetall(QString key) {
-    QList<QVariant> data =
-        this->data_from_reply(this->runredis(QString("hgetall %1").arg(key)));
+    RedisReply reply = this->runredis(RedisCommand("hgetall") << key);
+    RedisReplyView data = reply.view();
     QHash<QString, QVariant> ret;
-    for (int i = 1; i < data.size(); i += 2) {
-        ret[data[i - 1].toList()[0].toString()] = data[i].toList()[0];
+    ret.reserve(data.size() / 2);
+    for (size_t i = 1; i < data.size(); i += 2) {
+        ret[data[i - 1].string()] = data[i].value();
     }
     return ret;
 }
 
 qint64 RedisController::lpush(QString key, QList<QVariant> values) {
-    QString cmd = QString("lpush %1").arg(key);
+    RedisCommand cmd("lpush");
+    cmd << key;
     for (QVariant& item : values) {
-        cmd += QString(" %1").arg(item.toString());
+        cmd << item;
     }
-    return this->data_from_reply(this->runredis(cmd))[0].toInt();
+    return this->runredis(cmd).view().integer();
 }
 
 qint64 RedisController::rpush(QString key, QList<QVariant> values) {
-    QString cmd = QString("rpush %1").arg(key);
+    RedisCommand cmd("rpush");
+    cmd << key;
     for (QVariant& item : values) {
-        cmd += QString(" %1").arg(item.toString());
+        cmd << item;
     }
-    return this->data_from_reply(this->runredis(cmd))[0].toInt();
+    return this->runredis(cmd).view().integer();
 }
 
 qint64 RedisController::llen(QString key) {
-    return this->data_from_reply(this->runredis(QString("llen %1").arg(key)))[0]
-        .toInt();
+    return this->runredis(RedisCommand("llen") << key).view().integer();
 }
 
 QVariant RedisController::lindex(QString key, qint64 index) {
-    return this->data_from_reply(
-        this->runredis(QString("lindex %1 %2").arg(key).arg(index)))[0];
+    return this->runredis(RedisCommand("lindex") << key << index)
+        .view()
+        .value();
 }
 
 bool RedisController::lset(QString key, qint64 index, QVariant value) {
-    return this->data_from_reply(this->runredis(QString("lset %1 %2 %3")
-                                                    .arg(key)
-                                                    .arg(index)
-                                                    .arg(value.toString())))[0]
-               .toString() == "OK";
+    RedisCommand cmd("lset");
+    cmd << key << index << value;
+    return this->runredis(cmd).view().equals("OK");
 }
 
 QList<QVariant> RedisController::lrange(QString key, qint64 start, qint64 end) {
-    QList<QVariant> data = this->data_from_reply(this->runredis(
-        QString("lrange %1 %2 %3").arg(key).arg(start).arg(end)));
-    QList<QVariant> ret;
-    for (QVariant& item : data) {
-        if (item.type() == QVariant::List) {
-            ret.push_back(item.toList()[0]);
-        }
-    }
-    return ret;
+    return reply_values(
+        this->runredis(RedisCommand("lrange") << key << start << end).view());
 }
 
 QList<QVariant> RedisController::lpop(QString key, qint64 count) {
-    QList<QVariant> data = this->data_from_reply(
-        this->runredis(QString("lpop %1 %2").arg(key).arg(count)));
-    QList<QVariant> ret;
-    for (QVariant& item : data) {
-        if (item.type() == QVariant::List) {
-            ret.push_back(item.toList()[0]);
-        }
-    }
-    return ret;
+    return reply_values(
+        this->runredis(RedisCommand("lpop") << key << count).view());
 }
 
 QList<QVariant> RedisController::rpop(QString key, qint64 count) {
-    QList<QVariant> data = this->data_from_reply(
-        this->runredis(QString("rpop %1 %2").arg(key).arg(count)));
-    QList<QVariant> ret;
-    for (QVariant& item : data) {
-        if (item.type() == QVariant::List) {
-            ret.push_back(item.toList()[0]);
-        }
-    }
-    return ret;
+    return reply_values(
+        this->runredis(RedisCommand("rpop") << key << count).view());
 }
 
 QString RedisController::xadd(QString stream, QHash<QString, QVariant> data,
                               QString key) {
-    QString cmd = QString("xadd %1 %2").arg(stream).arg(key);
+    RedisCommand cmd("xadd");
+    cmd << stream << key;
     for (QHash<QString, QVariant>::iterator it = data.begin(); it != data.end();
          ++it) {
-        cmd += QString(" %1 %2").arg(it.key()).arg(it.value().toString());
+        cmd << it.key() << it.value();
     }
-    return this->data_from_reply(this->runredis(cmd))[0].toString();
+    return this->runredis(cmd).view().string();
 }
 
-QList<QPair<QString, QHash<QString, QVariant>>> RedisController::xread(
-    QString stream, qint64 block, qint64 count) {
-    QList<QVariant> data = this->data_from_reply(
-        this->runredis(QString("xread %1 %2 %3 0")
-                           .arg(count > 0 ? QString("count %1").arg(count) : "")
-                           .arg(block > 0 ? QString("block %1").arg(block) : "")
-                           .arg(QString("streams %1").arg(stream))));
-    QList<QPair<QString, QHash<QString, QVariant>>> ret;
-    if (data.size() && data[0].toList().size()) {
-        QList<QVariant> messages = data[0].toList()[1].toList();
-        for (int i = 0; i < messages.size(); ++i) {
-            QPair<QString, QHash<QString, QVariant>> message;
-            message.first = messages[i].toList()[0].toList()[0].toString();
-            QList<QVariant> hashes = messages[i].toList()[1].toList();
-            for (int i = 1; i < hashes.size(); i += 2) {
-                message.second[hashes[i - 1].toList()[0].toString()] =
-                    hashes[i].toList()[0];
-            }
-            ret.push_back(message);
+static RedisCommand xread_command(const QString& stream, qint64 block,
+                                  qint64 count, const QString& id = "0") {
+    RedisCommand cmd("xread");
+    if (count > 0) {
+        cmd << "count" << count;
+    }
+    if (block > 0) {
+        cmd << "block" << block;
+    }
+    cmd << "streams" << stream << id;
+    return cmd;
+}
+
+static RedisStreamMessages stream_entries(const RedisReplyView& entries) {
+    RedisStreamMessages ret;
+    ret.reserve(entries.size());
+    for (RedisReplyView entry : entries) {
+        QPair<QString, QHash<QString, QVariant>> message;
+        message.first = entry[0].string();
+        RedisReplyView fields = entry[1];
+        for (size_t i = 1; i < fields.size(); i += 2) {
+            message.second[fields[i - 1].string()] = fields[i].value();
         }
+        ret.push_back(message);
     }
     return ret;
 }
 
+static RedisStreamMessages xread_messages(const RedisReplyView& reply) {
+    return stream_entries(reply.type() == RedisDataType::Map ? reply[1]
+                                                             : reply[0][1]);
+}
+
+static RedisStreamBatch stream_batch(const RedisReplyView& reply) {
+    RedisStreamBatch ret;
+    if (reply.type() == RedisDataType::Map) {
+        for (size_t i = 1; i < reply.size(); i += 2) {
+            ret.push_back({reply[i - 1].string(), stream_entries(reply[i])});
+        }
+        return ret;
+    }
+    for (RedisReplyView stream : reply) {
+        ret.push_back({stream[0].string(), stream_entries(stream[1])});
+    }
+    return ret;
+}
+
+QList<QPair<QString, QHash<QString, QVariant>>> RedisController::xread(
+    QString stream, qint64 block, qint64 count, QString id) {
+    return xread_messages(
+        this->runredis(xread_command(stream, block, count, id)).view());
+}
+
 QList<QPair<QString, QHash<QString, QVariant>>> RedisController::xrange(
     QString key, QString start, QString end) {
-    QList<QVariant> data = this->data_from_reply(this->runredis(
-        QString("xrange %1 %2 %3").arg(key).arg(start).arg(end)));
-    QList<QPair<QString, QHash<QString, QVariant>>> ret;
-    if (data.size() && data[0].toList().size()) {
-        for (int i = 0; i < data.size(); ++i) {
-            QPair<QString, QHash<QString, QVariant>> message;
-            message.first = data[i].toList()[0].toList()[0].toString();
-            QList<QVariant> hashes = data[i].toList()[1].toList();
-            for (int i = 1; i < hashes.size(); i += 2) {
-                message.second[hashes[i - 1].toList()[0].toString()] =
-                    hashes[i].toList()[0];
+    return stream_entries(
+        this->runredis(RedisCommand("xrange") << key << start << end).view());
+}
+
+qint64 RedisController::xdel(QString key, QList<QString> ids) {
+    if (ids.isEmpty()) return 0;
+    return this->runredis(RedisCommand("xdel") << key << ids).view().integer();
+}
+
+bool RedisController::xgroupcreate(QString stream, QString group, QString id,
+                                   bool mkstream) {
+    RedisCommand cmd("xgroup");
+    cmd << "create" << stream << group << id;
+    if (mkstream) {
+        cmd << "mkstream";
+    }
+    RedisReply reply = this->runredis(cmd);
+    RedisReplyView view = reply.view();
+    return view.equals("OK") ||
+           (view.isError() && view.bytes().startsWith("BUSYGROUP"));
+}
+
+RedisStreamBatch RedisController::xreadgroup(QString group, QString consumer,
+                                             QList<QString> streams,
+                                             QList<QString> ids, qint64 count,
+                                             qint64 block) {
+    if (streams.isEmpty() || streams.size() != ids.size()) {
+        return RedisStreamBatch();
+    }
+    RedisCommand cmd("xreadgroup");
+    cmd << "group" << group << consumer;
+    if (count > 0) {
+        cmd << "count" << count;
+    }
+    if (block > 0) {
+        cmd << "block" << block;
+    }
+    cmd << "streams" << streams << ids;
+    return stream_batch(this->runredis(cmd).view());
+}
+
+qint64 RedisController::xack(QString stream, QString group,
+                             QList<QString> ids) {
+    if (ids.isEmpty()) return 0;
+    return this->runredis(RedisCommand("xack") << stream << group << ids)
+        .view()
+        .integer();
+}
+
+qint64 RedisController::xpending(QString stream, QString group) {
+    return this->runredis(RedisCommand("xpending") << stream << group)
+        .view()[0]
+        .integer();
+}
+
+QPair<QString, RedisStreamMessages> RedisController::xautoclaim(
+    QString stream, QString group, QString consumer, qint64 min_idle_ms,
+    QString start, qint64 count) {
+    RedisCommand cmd("xautoclaim");
+    cmd << stream << group << consumer << min_idle_ms << start;
+    if (count > 0) {
+        cmd << "count" << count;
+    }
+    RedisReply reply = this->runredis(cmd);
+    RedisReplyView data = reply.view();
+    QPair<QString, RedisStreamMessages> ret;
+    if (data.size() > 1) {
+        ret.first = data[0].string();
+        ret.second = stream_entries(data[1]);
+    }
+    return ret;
+}
+
+RedisScan::RedisScan(RedisController& controller, RedisDataType kind,
+                     QString key, QString match, qint64 count, QString type,
+                     bool prefetch)
+    : controller(controller),
+      kind(kind),
+      key(key.toUtf8()),
+      match(match.toUtf8()),
+      count(count),
+      type(type.toUtf8()),
+      prefetch(prefetch) {}
+
+RedisScan::~RedisScan() {
+    if (this->pending.valid()) {
+        this->pending.wait();
+    }
+}
+
+bool RedisScan::next(RedisScanItem& item) {
+    if (!this->fetch()) {
+        return false;
+    }
+    item = this->page[this->position];
+    this->position += 1;
+    return true;
+}
+
+bool RedisScan::fetch() {
+    while (this->position >= this->page.size()) {
+        if (this->finished) {
+            return false;
+        }
+        RedisReply reply = this->pending.valid()
+                               ? this->pending.get()
+                               : this->controller.runredis(this->command());
+        if (!this->load(reply.view())) {
+            this->failed = true;
+            this->finished = true;
+            return false;
+        }
+        if (this->finished || !this->prefetch) {
+            continue;
+        }
+        if (this->prefetcher == nullptr) {
+            std::unique_ptr<RedisController> connection(new RedisController(
+                this->controller.host, this->controller.port,
+                this->controller.user, this->controller.pass));
+            connection->connect();
+            if (connection->getConnected() &&
+                (this->controller.db == 0 ||
+                 connection->select(this->controller.db))) {
+                this->prefetcher = std::move(connection);
+            } else {
+                this->prefetch = false;
+                continue;
             }
-            ret.push_back(message);
         }
+        RedisController* connection = this->prefetcher.get();
+        RedisCommand cmd = this->command();
+        this->pending = std::async(std::launch::async, [connection, cmd]() {
+            return connection->runredis(cmd);
+        });
+    }
+    return true;
+}
+
+RedisCommand RedisScan::command() const {
+    RedisCommand cmd;
+    bool keyspace = false;
+    switch (this->kind) {
+        case RedisDataType::Hash:
+            cmd << "hscan" << this->key;
+            break;
+        case RedisDataType::Set:
+            cmd << "sscan" << this->key;
+            break;
+        case RedisDataType::ZSet:
+            cmd << "zscan" << this->key;
+            break;
+        default:
+            cmd << "scan";
+            keyspace = true;
+            break;
+    }
+    cmd << this->cursor;
+    if (!this->match.isEmpty()) {
+        cmd << "match" << this->match;
+    }
+    if (this->count > 0) {
+        cmd << "count" << this->count;
+    }
+    if (keyspace && !this->type.isEmpty()) {
+        cmd << "type" << this->type;
+    }
+    return cmd;
+}
+
+bool RedisScan::load(const RedisReplyView& reply) {
+    if (reply.size() < 2) {
+        return false;
+    }
+    RedisReplyView cursor = reply[0];
+    this->cursor = QByteArray(cursor.data(), cursor.length());
+    this->finished = this->cursor == "0";
+    RedisReplyView items = reply[1];
+    bool pairs = this->kind == RedisDataType::Hash ||
+                 this->kind == RedisDataType::ZSet;
+    this->page.clear();
+    this->page.reserve(pairs ? items.size() / 2 : items.size());
+    this->position = 0;
+    for (size_t i = 0; i < items.size(); i += pairs ? 2 : 1) {
+        RedisScanItem item;
+        item.key = items[i].string();
+        if (this->kind == RedisDataType::Hash) {
+            item.value = items[i + 1].value();
+        } else if (this->kind == RedisDataType::ZSet) {
+            item.value = items[i + 1].real();
+        }
+        this->page.push_back(item);
+    }
+    return true;
+}
+
+RedisStreamConsumer::RedisStreamConsumer(RedisController& controller,
+                                         QString group, QString consumer,
+                                         QList<QString> streams, qint64 count,
+                                         qint64 block_ms)
+    : controller(controller),
+      group(group),
+      consumer(consumer),
+      streams(streams),
+      count(count),
+      block_ms(block_ms) {}
+
+RedisStreamConsumer::~RedisStreamConsumer() { this->stop(); }
+
+void RedisStreamConsumer::setClaim(qint64 min_idle_ms, qint64 interval_ms) {
+    this->claim_idle_ms = min_idle_ms;
+    this->claim_interval_ms = interval_ms;
+}
+
+bool RedisStreamConsumer::createGroups(QString start_id) {
+    bool ret = true;
+    for (const QString& stream : this->streams) {
+        ret = this->controller.xgroupcreate(stream, this->group, start_id) &&
+              ret;
     }
     return ret;
 }
 
-qint64 RedisController::xdel(QString key, QList<QString> ids) {
-    return this
-        ->data_from_reply(this->runredis(
-            QString("xdel %1 %2").arg(key).arg(ids.join(' '))))[0]
-        .toInt();
+qint64 RedisStreamConsumer::poll(Handler handler) {
+    QList<Job> batch = this->read_batch();
+    QHash<QString, QList<QString>> acks;
+    for (const Job& job : batch) {
+        if (handler(job.stream, job.message)) {
+            acks[job.stream].push_back(job.message.first);
+        }
+    }
+    this->acknowledge(acks);
+    return batch.size();
+}
+
+bool RedisStreamConsumer::start(Handler handler, int workers) {
+    if (this->running.exchange(true)) {
+        return false;
+    }
+    this->handler = handler;
+    for (int i = 0; i < qMax(workers, 1); ++i) {
+        this->workers.emplace_back(&RedisStreamConsumer::worker_loop, this);
+    }
+    this->reader = std::thread(&RedisStreamConsumer::reader_loop, this);
+    return true;
+}
+
+void RedisStreamConsumer::stop() {
+    if (!this->running.exchange(false)) {
+        return;
+    }
+    if (this->reader.joinable()) {
+        this->reader.join();
+    }
+    this->lock.lock();
+    this->closing = true;
+    this->queued.wakeAll();
+    this->lock.unlock();
+    for (std::thread& worker : this->workers) {
+        worker.join();
+    }
+    this->workers.clear();
+    this->closing = false;
+}
+
+QString RedisStreamConsumer::lastDelivered(QString stream) {
+    QMutexLocker guard(&this->lock);
+    return this->last_ids.value(stream);
+}
+
+qint64 RedisStreamConsumer::pending(QString stream) {
+    return this->controller.xpending(stream, this->group);
+}
+
+QList<RedisStreamConsumer::Job> RedisStreamConsumer::read_batch() {
+    QList<Job> batch;
+    // claimed entries join our pending list, so claiming waits until the
+    // history read is done or it would hand them out twice.
+    if (this->claim_idle_ms > 0 && !this->reading_history() &&
+        (!this->claim_clock.isValid() ||
+         this->claim_clock.elapsed() >= this->claim_interval_ms)) {
+        this->claim_clock.start();
+        for (const QString& stream : this->streams) {
+            QPair<QString, RedisStreamMessages> claimed =
+                this->controller.xautoclaim(
+                    stream, this->group, this->consumer, this->claim_idle_ms,
+                    this->claim_cursors.value(stream, "0-0"), this->count);
+            this->claim_cursors[stream] =
+                claimed.first.isEmpty() ? "0-0" : claimed.first;
+            for (const RedisStreamMessage& message : claimed.second) {
+                if (!message.first.isEmpty()) {
+                    batch.push_back({stream, message});
+                }
+            }
+        }
+    }
+
+    // our own pending entries are read from id 0 first, then new ones by >.
+    QList<QString> ids;
+    bool history = false;
+    for (const QString& stream : this->streams) {
+        ids.push_back(this->cursors.value(stream, "0"));
+        history = history || ids.back() != ">";
+    }
+    RedisStreamBatch read = this->controller.xreadgroup(
+        this->group, this->consumer, this->streams, ids, this->count,
+        history || !batch.isEmpty() ? -1 : this->block_ms);
+    if (this->controller.getFailed()) {
+        return batch;
+    }
+    QHash<QString, QString> history_ends;
+    for (const QPair<QString, RedisStreamMessages>& stream : read) {
+        for (const RedisStreamMessage& message : stream.second) {
+            batch.push_back({stream.first, message});
+        }
+        if (!stream.second.isEmpty()) {
+            history_ends[stream.first] = stream.second.back().first;
+        }
+    }
+    QMutexLocker guard(&this->lock);
+    for (const QString& stream : this->streams) {
+        if (this->cursors.value(stream, "0") != ">") {
+            this->cursors[stream] = history_ends.value(stream, ">");
+        }
+    }
+    for (const Job& job : batch) {
+        this->last_ids[job.stream] = job.message.first;
+    }
+    return batch;
+}
+
+void RedisStreamConsumer::acknowledge(
+    const QHash<QString, QList<QString>>& acks) {
+    QList<RedisCommand> cmds;
+    for (QHash<QString, QList<QString>>::const_iterator it = acks.begin();
+         it != acks.end(); ++it) {
+        for (int i = 0; i < it.value().size(); i += REDIS_BULK_CHUNK) {
+            cmds.push_back(RedisCommand("xack")
+                           << it.key() << this->group
+                           << it.value().mid(i, REDIS_BULK_CHUNK));
+        }
+    }
+    if (!cmds.isEmpty()) {
+        this->controller.runpipeline(cmds);
+    }
+}
+
+bool RedisStreamConsumer::reading_history() {
+    for (const QString& stream : this->streams) {
+        if (this->cursors.value(stream, "0") != ">") {
+            return true;
+        }
+    }
+    return false;
+}
+
+void RedisStreamConsumer::reader_loop() {
+    while (this->running.load()) {
+        if (this->controller.getFailed()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            this->controller.connect();
+            continue;
+        }
+        QList<Job> batch;
+        try {
+            batch = this->read_batch();
+        } catch (const char*) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            continue;
+        }
+        if (batch.isEmpty()) {
+            continue;
+        }
+        this->lock.lock();
+        this->jobs.append(batch);
+        this->in_flight = batch.size();
+        this->queued.wakeAll();
+        while (this->in_flight > 0) {
+            this->drained.wait(&this->lock);
+        }
+        QHash<QString, QList<QString>> acks;
+        acks.swap(this->acks);
+        this->lock.unlock();
+        forever {
+            try {
+                this->acknowledge(acks);
+                break;
+            } catch (const char*) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
 }
 
-QList<QVariant> RedisController::data_from_reply(RedisReply& reply) {
-    QList<QVariant> data = reply.getData();
-    reply.dispose();
-    return data;
+void RedisStreamConsumer::worker_loop() {
+    this->lock.lock();
+    forever {
+        while (this->jobs.isEmpty() && !this->closing) {
+            this->queued.wait(&this->lock);
+        }
+        if (this->jobs.isEmpty()) {
+            break;
+        }
+        Job job = this->jobs.takeFirst();
+        this->lock.unlock();
+        bool handled = this->handler(job.stream, job.message);
+        this->lock.lock();
+        if (handled) {
+            this->acks[job.stream].push_back(job.message.first);
+        }
+        this->in_flight -= 1;
+        if (this->in_flight == 0) {
+            this->drained.wakeAll();
+        }
+    }
+    this->lock.unlock();
+}
+
+RedisPool::Lease& RedisPool::Lease::operator=(Lease&& rvalue) {
+    if (this != &rvalue) {
+        this->release();
+        this->pool = rvalue.pool;
+        this->controller = rvalue.controller;
+        rvalue.pool = nullptr;
+        rvalue.controller = nullptr;
+    }
+    return *this;
+}
+
+void RedisPool::Lease::release() {
+    if (this->pool != nullptr && this->controller != nullptr) {
+        this->pool->release(this->controller);
+    }
+    this->pool = nullptr;
+    this->controller = nullptr;
+}
+
+// how long ~RedisPool waits for leases still in use before giving up.
+const qint64 REDIS_POOL_CLOSE_WAIT_MS = 5000;
+
+RedisPool::RedisPool(QString host, quint16 port, QString user, QString pass,
+                     quint32 min_size, quint32 max_size, qint64 idle_check_ms)
+    : host(host),
+      port(port),
+      user(user),
+      pass(pass),
+      min_size(qMin(min_size, qMax(max_size, 1u))),
+      max_size(qMax(max_size, 1u)),
+      idle_check_ms(idle_check_ms) {
+    this->clock.start();
+    this->fill();
+    if (this->idle_check_ms > 0) {
+        this->sweeper = std::thread(&RedisPool::sweep_loop, this);
+    }
 }
 
-QList<QVariant> RedisController::data_from_reply(RedisReply reply) {
-    QList<QVariant> data = reply.getData();
-    reply.dispose();
-    return data;
+RedisPool::~RedisPool() {
+    this->lock.lock();
+    this->closing = true;
+    this->woken.wakeAll();
+    this->lock.unlock();
+    if (this->sweeper.joinable()) {
+        this->sweeper.join();
+    }
+    QElapsedTimer waited;
+    waited.start();
+    this->lock.lock();
+    while (this->idle.size() < (int)this->total) {
+        qint64 remaining = REDIS_POOL_CLOSE_WAIT_MS - waited.elapsed();
+        Q_ASSERT_X(remaining > 0, "RedisPool::~RedisPool",
+                   "a lease outlived its pool");
+        if (remaining <= 0) break;
+        this->available.wait(&this->lock, (unsigned long)remaining);
+    }
+    for (IdleConnection& connection : this->idle) {
+        this->destroy(connection.controller);
+    }
+    this->idle.clear();
+    this->total = 0;
+    this->lock.unlock();
+}
+
+RedisPool::Lease RedisPool::acquire(qint64 timeout_ms) {
+    QElapsedTimer waited;
+    waited.start();
+    this->lock.lock();
+    forever {
+        if (!this->idle.isEmpty()) {
+            IdleConnection connection = this->idle.takeLast();
+            this->lock.unlock();
+            if (this->check(connection.controller,
+                            this->clock.elapsed() - connection.since_ms)) {
+                return Lease(this, connection.controller);
+            }
+            this->destroy(connection.controller);
+            this->lock.lock();
+            this->total -= 1;
+            this->lock.unlock();
+            this->fill();
+            this->lock.lock();
+            continue;
+        }
+        if (this->total < this->max_size) {
+            this->total += 1;
+            this->lock.unlock();
+            RedisController* controller = this->create();
+            if (controller != nullptr) return Lease(this, controller);
+            this->lock.lock();
+            this->total -= 1;
+            this->available.wakeAll();
+            this->lock.unlock();
+            return Lease();
+        }
+        qint64 remaining = timeout_ms - waited.elapsed();
+        if (remaining <= 0 ||
+            !this->available.wait(&this->lock, (unsigned long)remaining)) {
+            this->lock.unlock();
+            return Lease();
+        }
+    }
+}
+
+quint32 RedisPool::size() {
+    QMutexLocker guard(&this->lock);
+    return this->total;
+}
+
+quint32 RedisPool::idleSize() {
+    QMutexLocker guard(&this->lock);
+    return this->idle.size();
+}
+
+RedisController* RedisPool::create() {
+    RedisController* controller =
+        new RedisController(this->host, this->port, this->user, this->pass);
+    controller->connect();
+    if (!controller->getConnected()) {
+        delete controller;
+        return nullptr;
+    }
+    return controller;
+}
+
+bool RedisPool::check(RedisController* controller, qint64 idle_ms) {
+    if (!controller->getFailed() && idle_ms < this->idle_check_ms) return true;
+    if (!controller->getFailed() && controller->ping()) return true;
+    controller->connect();
+    return controller->getConnected() && controller->ping();
+}
+
+void RedisPool::destroy(RedisController* controller) { delete controller; }
+
+void RedisPool::release(RedisController* controller) {
+    if (controller->getFailed()) {
+        this->destroy(controller);
+        this->lock.lock();
+        this->total -= 1;
+        this->available.wakeAll();
+        this->lock.unlock();
+        this->fill();
+        return;
+    }
+    this->lock.lock();
+    this->idle.push_back({controller, this->clock.elapsed()});
+    this->available.wakeAll();
+    this->lock.unlock();
+}
+
+void RedisPool::fill() {
+    this->lock.lock();
+    quint32 missing =
+        this->closing || this->total >= this->min_size
+            ? 0
+            : this->min_size - this->total;
+    this->total += missing;
+    this->lock.unlock();
+    for (quint32 i = 0; i < missing; ++i) {
+        RedisController* controller = this->create();
+        this->lock.lock();
+        if (controller == nullptr) {
+            this->total -= 1;
+        } else {
+            this->idle.push_back({controller, this->clock.elapsed()});
+        }
+        this->available.wakeAll();
+        this->lock.unlock();
+    }
+}
+
+void RedisPool::sweep_loop() {
+    this->lock.lock();
+    while (!this->closing) {
+        this->woken.wait(&this->lock, (unsigned long)this->idle_check_ms);
+        if (this->closing) break;
+        // stale connections are taken out while they are pinged so acquire
+        // never hands one out half checked.
+        QList<IdleConnection> stale;
+        qint64 now = this->clock.elapsed();
+        for (int i = this->idle.size() - 1; i >= 0; --i) {
+            if (now - this->idle[i].since_ms >= this->idle_check_ms) {
+                stale.push_back(this->idle.takeAt(i));
+            }
+        }
+        this->lock.unlock();
+        QList<IdleConnection> healthy;
+        quint32 broken = 0;
+        for (const IdleConnection& connection : stale) {
+            if (this->check(connection.controller, this->idle_check_ms)) {
+                healthy.push_back({connection.controller,
+                                   this->clock.elapsed()});
+            } else {
+                this->destroy(connection.controller);
+                broken += 1;
+            }
+        }
+        this->lock.lock();
+        this->idle.append(healthy);
+        this->total -= broken;
+        this->available.wakeAll();
+        this->lock.unlock();
+        this->fill();
+        this->lock.lock();
+    }
+    this->lock.unlock();
+}
+
+RedisAsyncController::RedisAsyncController(QString host, quint16 port,
+                                           QString user, QString pass,
+                                           QObject* parent)
+    : QObject(parent), host(host), port(port), user(user), pass(pass) {
+    this->timer = new QTimer(this);
+    this->timer->setSingleShot(true);
+    QObject::connect(this->timer, SIGNAL(timeout()), this,
+                     SLOT(handle_timeout()));
+}
+
+RedisAsyncController::~RedisAsyncController() {
+    if (this->context != nullptr) {
+        redisAsyncContext* context = this->context;
+        context->data = nullptr;
+        this->context = nullptr;
+        redisAsyncFree(context);
+    }
+}
+
+void RedisAsyncController::setTimeout(qint64 timeout_ms) {
+    this->timeout_ms = timeout_ms;
+    if (this->context != nullptr && timeout_ms > 0) {
+        struct timeval tv;
+        tv.tv_sec = timeout_ms / 1000;
+        tv.tv_usec = timeout_ms % 1000 * 1000;
+        redisAsyncSetTimeout(this->context, tv);
+    }
+}
+
+bool RedisAsyncController::getConnected() {
+    return this->context != nullptr && this->ready;
+}
+
+qint64 RedisAsyncController::getPending() { return this->pending; }
+
+void RedisAsyncController::connect() {
+    if (this->context != nullptr) {
+        return;
+    }
+    this->context = redisAsyncConnect(this->host.toStdString().c_str(),
+                                      this->port);
+    if (this->context == nullptr || this->context->err != 0) {
+        QString reason = this->context == nullptr
+                             ? QString("cannot allocate redis context")
+                             : QString(this->context->errstr);
+        if (this->context != nullptr) {
+            redisAsyncFree(this->context);
+            this->context = nullptr;
+        }
+        emit this->failed(reason);
+        return;
+    }
+    this->context->data = this;
+    this->attach();
+    redisAsyncSetConnectCallback(this->context,
+                                 &RedisAsyncController::on_connect);
+    redisAsyncSetDisconnectCallback(this->context,
+                                    &RedisAsyncController::on_disconnect);
+    this->setTimeout(this->timeout_ms);
+    if (!this->pass.isEmpty()) {
+        RedisCommand cmd("auth");
+        if (!this->user.isEmpty()) {
+            cmd << this->user;
+        }
+        cmd << this->pass;
+        this->command(cmd, [this](const RedisReply& reply) {
+            if (!reply.view().isError()) {
+                return;
+            }
+            emit this->failed(reply.view().string());
+            this->disconnect();
+        });
+    }
+}
+
+void RedisAsyncController::disconnect() {
+    if (this->context != nullptr) {
+        redisAsyncDisconnect(this->context);
+    }
+}
+
+bool RedisAsyncController::command(const RedisCommand& cmd,
+                                   RedisCallback callback) {
+    if (this->context == nullptr) {
+        return false;
+    }
+    std::vector<const char*> argv;
+    std::vector<size_t> argvlen;
+    cmd.prepare(argv, argvlen);
+    RedisCallback* privdata =
+        callback ? new RedisCallback(std::move(callback)) : nullptr;
+    if (redisAsyncCommandArgv(this->context, &RedisAsyncController::on_reply,
+                              privdata, argv.size(), argv.data(),
+                              argvlen.data()) != REDIS_OK) {
+        delete privdata;
+        return false;
+    }
+    this->pending += 1;
+    return true;
+}
+
+QFuture<QList<QVariant>> RedisAsyncController::request(
+    const RedisCommand& cmd) {
+    QFutureInterface<QList<QVariant>> promise;
+    promise.reportStarted();
+    bool queued =
+        this->command(cmd, [promise](const RedisReply& reply) mutable {
+            promise.reportResult(reply.getData());
+            promise.reportFinished();
+        });
+    if (!queued) {
+        promise.reportResult(QList<QVariant>());
+        promise.reportFinished();
+    }
+    return promise.future();
+}
+
+bool RedisAsyncController::ping(std::function<void(bool)> callback) {
+    return this->command(RedisCommand("ping"),
+                         [callback](const RedisReply& reply) {
+                             if (callback) {
+                                 callback(reply.view().equals("PONG"));
+                             }
+                         });
+}
+
+bool RedisAsyncController::get(QString key,
+                               std::function<void(QVariant)> callback) {
+    return this->command(RedisCommand("get") << key,
+                         [callback](const RedisReply& reply) {
+                             if (callback) {
+                                 callback(reply.view().value());
+                             }
+                         });
+}
+
+bool RedisAsyncController::set(QString key, QVariant value,
+                               std::function<void(bool)> callback,
+                               qint64 expire) {
+    RedisCommand cmd("set");
+    cmd << key << value;
+    if (expire > 0) {
+        cmd << "ex" << expire;
+    }
+    return this->command(cmd, [callback](const RedisReply& reply) {
+        if (callback) {
+            callback(reply.view().equals("OK"));
+        }
+    });
+}
+
+bool RedisAsyncController::xread(
+    QString stream, qint64 block, qint64 count,
+    std::function<void(RedisStreamMessages)> callback) {
+    return this->command(xread_command(stream, block, count),
+                         [callback](const RedisReply& reply) {
+                             if (callback) {
+                                 callback(xread_messages(reply.view()));
+                             }
+                         });
+}
+
+void RedisAsyncController::on_connect(const redisAsyncContext* context,
+                                      int status) {
+    RedisAsyncController* controller = (RedisAsyncController*)context->data;
+    if (controller == nullptr) {
+        return;
+    }
+    if (status != REDIS_OK) {
+        controller->context = nullptr;
+        emit controller->failed(QString(context->errstr));
+        return;
+    }
+    controller->ready = true;
+    emit controller->connected();
+}
+
+void RedisAsyncController::on_disconnect(const redisAsyncContext* context,
+                                         int status) {
+    RedisAsyncController* controller = (RedisAsyncController*)context->data;
+    if (controller == nullptr) {
+        return;
+    }
+    controller->context = nullptr;
+    controller->ready = false;
+    if (status != REDIS_OK) {
+        emit controller->failed(QString(context->errstr));
+    }
+    emit controller->disconnected();
+}
+
+void RedisAsyncController::on_reply(redisAsyncContext* context, void* reply,
+                                    void* privdata) {
+    RedisAsyncController* controller = (RedisAsyncController*)context->data;
+    if (controller != nullptr) {
+        controller->pending -= 1;
+    }
+    RedisCallback* callback = (RedisCallback*)privdata;
+    if (callback != nullptr) {
+        (*callback)(RedisReply::borrow((redisReply*)reply));
+        delete callback;
+    }
+}
+
+void RedisAsyncController::add_read(void* data) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    if (controller->read_notifier != nullptr) {
+        controller->read_notifier->setEnabled(true);
+    }
+}
+
+void RedisAsyncController::del_read(void* data) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    if (controller->read_notifier != nullptr) {
+        controller->read_notifier->setEnabled(false);
+    }
+}
+
+void RedisAsyncController::add_write(void* data) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    if (controller->write_notifier != nullptr) {
+        controller->write_notifier->setEnabled(true);
+    }
+}
+
+void RedisAsyncController::del_write(void* data) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    if (controller->write_notifier != nullptr) {
+        controller->write_notifier->setEnabled(false);
+    }
+}
+
+void RedisAsyncController::cleanup(void* data) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    // hiredis may free the context from inside a notifier's activation.
+    for (QSocketNotifier** notifier :
+         {&controller->read_notifier, &controller->write_notifier}) {
+        if (*notifier != nullptr) {
+            (*notifier)->setEnabled(false);
+            (*notifier)->deleteLater();
+            *notifier = nullptr;
+        }
+    }
+    controller->timer->stop();
+}
+
+void RedisAsyncController::schedule_timer(void* data, struct timeval tv) {
+    RedisAsyncController* controller = (RedisAsyncController*)data;
+    qint64 msecs = (qint64)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+    controller->timer->start((int)qMax(msecs, (qint64)1));
+}
+
+void RedisAsyncController::attach() {
+    this->context->ev.data = this;
+    this->context->ev.addRead = &RedisAsyncController::add_read;
+    this->context->ev.delRead = &RedisAsyncController::del_read;
+    this->context->ev.addWrite = &RedisAsyncController::add_write;
+    this->context->ev.delWrite = &RedisAsyncController::del_write;
+    this->context->ev.cleanup = &RedisAsyncController::cleanup;
+    this->context->ev.scheduleTimer = &RedisAsyncController::schedule_timer;
+
+    this->read_notifier =
+        new QSocketNotifier(this->context->c.fd, QSocketNotifier::Read, this);
+    this->read_notifier->setEnabled(false);
+    QObject::connect(this->read_notifier, SIGNAL(activated(int)), this,
+                     SLOT(handle_read()));
+    this->write_notifier =
+        new QSocketNotifier(this->context->c.fd, QSocketNotifier::Write, this);
+    this->write_notifier->setEnabled(false);
+    QObject::connect(this->write_notifier, SIGNAL(activated(int)), this,
+                     SLOT(handle_write()));
+}
+
+void RedisAsyncController::handle_read() {
+    if (this->context != nullptr) {
+        redisAsyncHandleRead(this->context);
+    }
+}
+
+void RedisAsyncController::handle_write() {
+    if (this->context != nullptr) {
+        redisAsyncHandleWrite(this->context);
+    }
+}
+
+void RedisAsyncController::handle_timeout() {
+    if (this->context != nullptr) {
+        redisAsyncHandleTimeout(this->context);
+    }
 }
 
 }  // namespace JDB
@@ -8,12 +8,27 @@
 #ifndef DATABASE_H
 #define DATABASE_H
 
+#include <async.h>
 #include <hiredis.h>
 
+#include <QCache>
 #include <QDebug>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
 #include <QObject>
+#include <QSocketNotifier>
 #include <QStringList>
+#include <QTimer>
 #include <QtSql>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace JDB {
 class MySQLODBCController : public QObject {
@@ -85,59 +100,175 @@ const QHash<QString, RedisDataType> REDIS_TYPE_MAP = {
     {"zset", RedisDataType::ZSet},     {"hash", RedisDataType::Hash},
 };
 
-struct RedisReply {
-    RedisReply() {}
-    RedisReply(redisReply* reply) : redisReply(reply) {}
-    RedisReply(const RedisReply& rvalue) {
-        this->redisReply = rvalue.redisReply;
+// bulk commands carry at most this many keys or pairs each and larger
+// batches are split and pipelined.
+const int REDIS_BULK_CHUNK = 1000;
+
+class RedisReplyView {
+   public:
+    class Iterator {
+       public:
+        Iterator(struct redisReply* const* element) : element(element) {}
+        RedisReplyView operator*() const {
+            return RedisReplyView(*this->element);
+        }
+        Iterator& operator++() {
+            ++this->element;
+            return *this;
+        }
+        bool operator!=(const Iterator& rvalue) const {
+            return this->element != rvalue.element;
+        }
+
+       private:
+        struct redisReply* const* element;
+    };
+
+    RedisReplyView() {}
+    RedisReplyView(const struct redisReply* reply) : reply(reply) {}
+
+    const struct redisReply* raw() const { return this->reply; }
+    bool isValid() const { return this->reply != nullptr; }
+    RedisDataType type() const {
+        return this->reply == nullptr ? RedisDataType::Nil
+                                      : (RedisDataType)this->reply->type;
     }
-    RedisReply(RedisReply& rvalue) { this->redisReply = rvalue.redisReply; }
-    ~RedisReply() {}
-    RedisReply& operator=(const RedisReply& rvalue) {
-        this->redisReply = rvalue.redisReply;
-        return *this;
+    bool isNil() const { return this->type() == RedisDataType::Nil; }
+    bool isError() const { return this->type() == RedisDataType::Error; }
+    bool isAggregate() const;
+    bool equals(const char* text) const;
+
+    // byte views alias the hiredis buffer and live as long as the reply.
+    const char* data() const;
+    qint64 length() const;
+    QByteArray bytes() const {
+        return QByteArray::fromRawData(this->data(), this->length());
+    }
+    QString string() const {
+        return QString::fromUtf8(this->data(), this->length());
+    }
+    qint64 integer() const;
+    double real() const;
+    QVariant value() const;
+
+    size_t size() const {
+        return this->isAggregate() ? this->reply->elements : 0;
     }
-    RedisReply& operator=(redisReply* rvalue) {
+    RedisReplyView operator[](size_t index) const {
+        return index < this->size() ? this->reply->element[index] : nullptr;
+    }
+    Iterator begin() const {
+        return Iterator(this->size() ? this->reply->element : nullptr);
+    }
+    Iterator end() const {
+        return Iterator(this->size() ? this->reply->element + this->size()
+                                     : nullptr);
+    }
+
+   private:
+    const struct redisReply* reply = nullptr;
+};
+
+struct RedisReply {
+    RedisReply() {}
+    RedisReply(struct redisReply* reply) { *this = reply; }
+    RedisReply& operator=(struct redisReply* rvalue) {
+        this->owner.reset(rvalue, freeReplyObject);
         this->redisReply = rvalue;
         return *this;
     }
-    RedisDataType getType() const {
-        return (RedisDataType)this->redisReply->type;
-    }
-    QList<QVariant> getData() const {
-        QList<QVariant> ret;
-        if (this->redisReply != nullptr) {
-            quint64 size = this->redisReply->elements;
-            switch (this->getType()) {
-                case RedisDataType::Nil:
-                    break;
-                case RedisDataType::String:
-                case RedisDataType::Status:
-                case RedisDataType::Error:
-                    ret.push_back(QString(this->redisReply->str));
-                    break;
-                case RedisDataType::Array:
-                    for (quint64 i = 0; i < size; ++i) {
-                        ret.push_back(
-                            RedisReply(this->redisReply->element[i]).getData());
-                    }
-                    break;
-                case RedisDataType::Integer:
-                    ret.push_back(this->redisReply->integer);
-                    break;
-                default:
-                    break;
-            }
-        }
+    static RedisReply borrow(struct redisReply* reply) {
+        RedisReply ret;
+        ret.redisReply = reply;
         return ret;
     }
+    RedisDataType getType() const { return this->view().type(); }
+    RedisReplyView view() const { return RedisReplyView(this->redisReply); }
+    QList<QVariant> getData() const;
     void dispose() {
-        if (this->redisReply != nullptr) {
-            freeReplyObject(this->redisReply);
-            this->redisReply = nullptr;
-        }
+        this->owner.reset();
+        this->redisReply = nullptr;
     }
-    redisReply* redisReply = nullptr;
+    struct redisReply* redisReply = nullptr;
+
+   private:
+    std::shared_ptr<struct redisReply> owner;
+};
+
+class RedisCommand {
+   public:
+    RedisCommand() {}
+    explicit RedisCommand(const char* name) { *this << name; }
+
+    RedisCommand& operator<<(const char* arg);
+    RedisCommand& operator<<(const QByteArray& arg);
+    RedisCommand& operator<<(const QString& arg);
+    RedisCommand& operator<<(const QVariant& arg);
+    RedisCommand& operator<<(const QList<QString>& args);
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value, RedisCommand&>::type
+    operator<<(T arg) {
+        this->args.push_back(QByteArray::number((qint64)arg));
+        return *this;
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value,
+                            RedisCommand&>::type
+    operator<<(T arg) {
+        this->args.push_back(QByteArray::number(
+            (double)arg, 'g', std::numeric_limits<T>::max_digits10));
+        return *this;
+    }
+
+    int size() const { return this->args.size(); }
+    const QList<QByteArray>& arguments() const { return this->args; }
+    void prepare(std::vector<const char*>& argv,
+                 std::vector<size_t>& argvlen) const;
+
+   private:
+    QList<QByteArray> args;
+};
+
+class RedisController;
+class RedisScan;
+
+class RedisPipeline {
+   public:
+    RedisPipeline(RedisController& controller, bool transaction = false);
+
+    RedisPipeline& operator<<(const RedisCommand& cmd);
+    RedisPipeline& add(const RedisCommand& cmd);
+    int size() const { return this->commands.size(); }
+    void clear();
+    bool exec();
+
+    RedisDataType type(int index) const;
+    bool isError(int index) const;
+    bool ok(int index) const;
+    QList<QVariant> data(int index) const;
+    QVariant value(int index) const;
+    QString string(int index) const;
+    qint64 integer(int index) const;
+
+   private:
+    RedisController& controller;
+    bool transaction;
+    QList<RedisCommand> commands;
+    QList<RedisDataType> types;
+    QList<QList<QVariant>> results;
+};
+
+typedef QPair<QString, QHash<QString, QVariant>> RedisStreamMessage;
+typedef QList<RedisStreamMessage> RedisStreamMessages;
+typedef QList<QPair<QString, RedisStreamMessages>> RedisStreamBatch;
+
+struct RedisCacheStats {
+    qint64 hits = 0;
+    qint64 misses = 0;
+    qint64 invalidations = 0;
+    qint64 flushes = 0;
+    qint64 entries = 0;
+    qint64 bytes = 0;
 };
 
 class RedisController {
@@ -149,16 +280,28 @@ class RedisController {
 
     void setHost(QString host, quint16 port = 6379);
     void setAuth(QString user, QString pass);
+    // caching keeps get/hget results until redis reports the key changed.
+    // invalidations arrive on a second RESP2 connection that tracking
+    // redirects to, so replies on this one keep their usual shapes.
+    // 0 turns it off.
+    void setCache(qint64 max_bytes);
 
     bool getConnected();
+    bool getFailed();
+    bool getCaching();
+    RedisCacheStats getCacheStats();
 
     void connect();
     void disconnect();
 
     RedisReply runredis(QString cmd);
+    RedisReply runredis(const RedisCommand& cmd);
+    QList<RedisReply> runpipeline(const QList<RedisCommand>& cmds);
     bool ping();
     QVariant get(QString key);
     bool set(QString key, QVariant value, qint64 expire = -1);
+    QList<QVariant> mget(QList<QString> keys);
+    bool mset(QHash<QString, QVariant> data);
     bool select(quint16 db);
     qint64 dbsize();
     bool flushdb();
@@ -166,6 +309,7 @@ class RedisController {
     QList<QString> keys(QString match = "*");
     bool exists(QString key);
     quint64 del(QList<QString> keys);
+    quint64 unlink(QList<QString> keys);
     bool move(QString key, quint16 db);
     RedisDataType type(QString key);
     bool expire(QString key, qint64 seconds);
@@ -175,6 +319,14 @@ class RedisController {
     bool persist(QString key);
     QPair<qint64, QList<QString>> scan(QString match = "", qint64 count = -1,
                                        qint64 cursor = 0);
+    RedisScan scanKeys(QString match = "", qint64 count = -1,
+                       QString type = "", bool prefetch = false);
+    RedisScan hscan(QString key, QString match = "", qint64 count = -1,
+                    bool prefetch = false);
+    RedisScan sscan(QString key, QString match = "", qint64 count = -1,
+                    bool prefetch = false);
+    RedisScan zscan(QString key, QString match = "", qint64 count = -1,
+                    bool prefetch = false);
     bool setnx(QString key, QVariant value);
     QVariant getset(QString key, QVariant value);
     qint64 append(QString key, QVariant value);
@@ -187,6 +339,7 @@ class RedisController {
     QString getrange(QString key, qint64 start, qint64 end);
     qint64 setrange(QString key, qint64 offset, QString value);
     bool hset(QString key, QString hkey, QVariant hvalue);
+    qint64 hset(QString key, QHash<QString, QVariant> data);
     bool hmset(QString key,
                QHash<QString, QVariant> data);  // for lower version compabality
     QVariant hget(QString key, QString hkey);
@@ -204,23 +357,327 @@ class RedisController {
                  QString key = "*");
     QList<QPair<QString, QHash<QString, QVariant>>> xread(QString stream,
                                                           qint64 block = -1,
-                                                          qint64 count = -1);
+                                                          qint64 count = -1,
+                                                          QString id = "0");
     QList<QPair<QString, QHash<QString, QVariant>>> xrange(QString key,
                                                            QString start = "-",
                                                            QString end = "+");
     qint64 xdel(QString key, QList<QString> ids);
+    bool xgroupcreate(QString stream, QString group, QString id = "$",
+                      bool mkstream = true);
+    RedisStreamBatch xreadgroup(QString group, QString consumer,
+                                QList<QString> streams, QList<QString> ids,
+                                qint64 count = -1, qint64 block = -1);
+    qint64 xack(QString stream, QString group, QList<QString> ids);
+    qint64 xpending(QString stream, QString group);
+    QPair<QString, RedisStreamMessages> xautoclaim(QString stream,
+                                                   QString group,
+                                                   QString consumer,
+                                                   qint64 min_idle_ms,
+                                                   QString start = "0-0",
+                                                   qint64 count = -1);
 
    private:
-    QList<QVariant> data_from_reply(RedisReply& reply);
-    QList<QVariant> data_from_reply(RedisReply reply);
+    friend class RedisScan;
+
+    struct CachedValue {
+        QVariant value;
+        qint64 bytes = 0;
+    };
+    struct CacheEntry {
+        CachedValue value;
+        bool has_value = false;
+        QHash<QByteArray, CachedValue> fields;
+        qint64 bytes = 0;
+    };
+
+    RedisReply execute(const RedisCommand& cmd);
+    quint64 run_keys(const char* name, const QList<QString>& keys);
+    QVariant cached(const RedisCommand& cmd, const QByteArray& key,
+                    const QByteArray* field);
+    bool start_tracking();
+    void stop_tracking();
+    void read_invalidations();
+    void invalidate(const RedisReplyView& message);
 
     redisContext* database = nullptr;
     QString host;
     quint16 port = 6379;
     QString user = "";
     QString pass = "";
+    quint16 db = 0;
+
+    QCache<QByteArray, CacheEntry> cache;
+    RedisCacheStats cache_stats;
+    qint64 cache_max_bytes = 0;
+    std::atomic<bool> tracking{false};
+    std::unique_ptr<RedisController> invalidations;
+
+    QMutex lock;
+};
+struct RedisScanItem {
+    QString key;
+    QVariant value;
+};
 
+// walks SCAN, HSCAN, SSCAN or ZSCAN one page at a time. like the server
+// commands it may yield an element more than once. with prefetch the pages
+// are fetched on a second connection while the caller uses the current one.
+class RedisScan {
+   public:
+    class Iterator {
+       public:
+        Iterator(RedisScan* scan = nullptr) : scan(scan) {}
+        const RedisScanItem& operator*() const {
+            return this->scan->page[this->scan->position];
+        }
+        const RedisScanItem* operator->() const { return &**this; }
+        Iterator& operator++() {
+            this->scan->position += 1;
+            if (!this->scan->fetch()) {
+                this->scan = nullptr;
+            }
+            return *this;
+        }
+        bool operator==(const Iterator& rvalue) const {
+            return this->scan == rvalue.scan;
+        }
+        bool operator!=(const Iterator& rvalue) const {
+            return this->scan != rvalue.scan;
+        }
+
+       private:
+        RedisScan* scan;
+    };
+
+    RedisScan(RedisController& controller,
+              RedisDataType kind = RedisDataType::Nil, QString key = "",
+              QString match = "", qint64 count = -1, QString type = "",
+              bool prefetch = false);
+    RedisScan(RedisScan&& rvalue) = default;
+    ~RedisScan();
+
+    Iterator begin() { return Iterator(this->fetch() ? this : nullptr); }
+    Iterator end() { return Iterator(); }
+    bool next(RedisScanItem& item);
+    bool getFailed() const { return this->failed; }
+
+   private:
+    bool fetch();
+    RedisCommand command() const;
+    bool load(const RedisReplyView& reply);
+
+    RedisController& controller;
+    RedisDataType kind;
+    QByteArray key;
+    QByteArray match;
+    qint64 count;
+    QByteArray type;
+    bool prefetch;
+
+    QByteArray cursor = "0";
+    bool finished = false;
+    bool failed = false;
+    QList<RedisScanItem> page;
+    int position = 0;
+    std::unique_ptr<RedisController> prefetcher;
+    std::future<RedisReply> pending;
+};
+
+// reads the streams through one consumer of a group. a message is acked once
+// its handler returns true, otherwise it stays pending until it is claimed
+// again. while started the consumer should be the only user of the
+// controller, if something else holds it the reader backs off and retries.
+// stop() waits for the reader's current xreadgroup, which can block for up
+// to block_ms.
+class RedisStreamConsumer {
+   public:
+    typedef std::function<bool(const QString& stream,
+                               const RedisStreamMessage& message)>
+        Handler;
+
+    RedisStreamConsumer(RedisController& controller, QString group,
+                        QString consumer, QList<QString> streams,
+                        qint64 count = 100, qint64 block_ms = 1000);
+    ~RedisStreamConsumer();
+
+    void setClaim(qint64 min_idle_ms, qint64 interval_ms = 30000);
+    bool createGroups(QString start_id = "$");
+    qint64 poll(Handler handler);
+    bool start(Handler handler, int workers = 1);
+    void stop();
+    QString lastDelivered(QString stream);
+    qint64 pending(QString stream);
+
+   private:
+    struct Job {
+        QString stream;
+        RedisStreamMessage message;
+    };
+
+    QList<Job> read_batch();
+    void acknowledge(const QHash<QString, QList<QString>>& acks);
+    bool reading_history();
+    void reader_loop();
+    void worker_loop();
+
+    RedisController& controller;
+    QString group;
+    QString consumer;
+    QList<QString> streams;
+    qint64 count;
+    qint64 block_ms;
+    qint64 claim_idle_ms = 0;
+    qint64 claim_interval_ms = 30000;
+    QElapsedTimer claim_clock;
+    QHash<QString, QString> cursors;
+    QHash<QString, QString> claim_cursors;
+    QHash<QString, QString> last_ids;
+
+    Handler handler;
+    std::atomic<bool> running{false};
+    std::thread reader;
+    std::vector<std::thread> workers;
+    QList<Job> jobs;
+    int in_flight = 0;
+    bool closing = false;
+    QHash<QString, QList<QString>> acks;
     QMutex lock;
+    QWaitCondition queued;
+    QWaitCondition drained;
+};
+
+// keeps at least min_size connections open. idle ones are pinged every
+// idle_check_ms in the background and broken ones are replaced. every lease
+// has to be returned before the pool is destroyed.
+class RedisPool {
+   public:
+    class Lease {
+       public:
+        Lease() {}
+        Lease(RedisPool* pool, RedisController* controller)
+            : pool(pool), controller(controller) {}
+        Lease(Lease&& rvalue) { *this = std::move(rvalue); }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        Lease& operator=(Lease&& rvalue);
+        ~Lease() { this->release(); }
+
+        bool isValid() const { return this->controller != nullptr; }
+        explicit operator bool() const { return this->isValid(); }
+        RedisController* operator->() const { return this->controller; }
+        RedisController& operator*() const { return *this->controller; }
+        void release();
+
+       private:
+        RedisPool* pool = nullptr;
+        RedisController* controller = nullptr;
+    };
+
+    RedisPool(QString host, quint16 port = 6379, QString user = "",
+              QString pass = "", quint32 min_size = 1, quint32 max_size = 8,
+              qint64 idle_check_ms = 30000);
+    ~RedisPool();
+
+    Lease acquire(qint64 timeout_ms = 1000);
+    quint32 size();
+    quint32 idleSize();
+
+   private:
+    struct IdleConnection {
+        RedisController* controller;
+        qint64 since_ms;
+    };
+
+    RedisController* create();
+    bool check(RedisController* controller, qint64 idle_ms);
+    void destroy(RedisController* controller);
+    void release(RedisController* controller);
+    void fill();
+    void sweep_loop();
+
+    QString host;
+    quint16 port;
+    QString user;
+    QString pass;
+    quint32 min_size;
+    quint32 max_size;
+    qint64 idle_check_ms;
+
+    QList<IdleConnection> idle;
+    quint32 total = 0;
+    QElapsedTimer clock;
+    bool closing = false;
+    std::thread sweeper;
+    QMutex lock;
+    QWaitCondition available;
+    QWaitCondition woken;
+};
+
+typedef std::function<void(const RedisReply& reply)> RedisCallback;
+
+// replies handed to callbacks are freed by hiredis once the callback returns,
+// and every call must be made from the thread owning the controller.
+class RedisAsyncController : public QObject {
+    Q_OBJECT
+   public:
+    RedisAsyncController(QString host, quint16 port = 6379, QString user = "",
+                         QString pass = "", QObject* parent = nullptr);
+    ~RedisAsyncController();
+
+    void setTimeout(qint64 timeout_ms);
+    bool getConnected();
+    qint64 getPending();
+
+    void connect();
+    void disconnect();
+
+    bool command(const RedisCommand& cmd,
+                 RedisCallback callback = RedisCallback());
+    QFuture<QList<QVariant>> request(const RedisCommand& cmd);
+    bool ping(std::function<void(bool)> callback);
+    bool get(QString key, std::function<void(QVariant)> callback);
+    bool set(QString key, QVariant value, std::function<void(bool)> callback,
+             qint64 expire = -1);
+    bool xread(QString stream, qint64 block, qint64 count,
+               std::function<void(RedisStreamMessages)> callback);
+
+   signals:
+    void connected();
+    void disconnected();
+    void failed(QString reason);
+
+   private:
+    static void on_connect(const redisAsyncContext* context, int status);
+    static void on_disconnect(const redisAsyncContext* context, int status);
+    static void on_reply(redisAsyncContext* context, void* reply,
+                         void* privdata);
+    static void add_read(void* data);
+    static void del_read(void* data);
+    static void add_write(void* data);
+    static void del_write(void* data);
+    static void cleanup(void* data);
+    static void schedule_timer(void* data, struct timeval tv);
+
+    void attach();
+
+   private slots:
+    void handle_read();
+    void handle_write();
+    void handle_timeout();
+
+   private:
+    redisAsyncContext* context = nullptr;
+    QSocketNotifier* read_notifier = nullptr;
+    QSocketNotifier* write_notifier = nullptr;
+    QTimer* timer = nullptr;
+    QString host;
+    quint16 port = 6379;
+    QString user = "";
+    QString pass = "";
+    qint64 timeout_ms = -1;
+    qint64 pending = 0;
+    bool ready = false;
 };
 }  // namespace JDB
 
@@ -0,0 +1,94 @@
+/*
+ * file name:       LogSinks.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include "LogSinks.h"
+
+#include <QHostInfo>
+
+namespace JLogs {
+
+static const int SYSLOG_FACILITY_USER = 1;
+static const int SYSLOG_SEVERITY[LEVEL_COUNT] = {7, 6, 4, 3, 2};
+
+static QString chop_newline(const QString &content) {
+    return content.endsWith("\n") ? content.left(content.size() - 1)
+                                  : content;
+}
+
+UdpSink::UdpSink(QString host, quint16 port, QString app_name, Level level,
+                 quint32 batch_size, quint32 flush_interval_ms)
+    : LogSink(level, batch_size, flush_interval_ms),
+      host(host),
+      port(port),
+      app_name(app_name.toUtf8()),
+      host_name(QHostInfo::localHostName().toUtf8()) {}
+
+UdpSink::~UdpSink() { this->stop(); }
+
+bool UdpSink::open() {
+    this->socket.reset(new QUdpSocket());
+    return true;
+}
+
+bool UdpSink::write(const QList<SinkRecord> &batch) {
+    QHostAddress address(this->host);
+    for (const SinkRecord &record : batch) {
+        QByteArray datagram("<");
+        datagram.append(QByteArray::number(SYSLOG_FACILITY_USER * 8 +
+                                           SYSLOG_SEVERITY[record.level]));
+        datagram.append(">1 ");
+        datagram.append(QDateTime::fromMSecsSinceEpoch(record.msecs)
+                            .toUTC()
+                            .toString("yyyy-MM-dd'T'hh:mm:ss.zzz'Z'")
+                            .toUtf8());
+        datagram.append(' ');
+        datagram.append(this->host_name);
+        datagram.append(' ');
+        datagram.append(this->app_name);
+        datagram.append(" - - - ");
+        datagram.append(chop_newline(record.content).toUtf8());
+        if (this->socket->writeDatagram(datagram, address, this->port) < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void UdpSink::close() { this->socket.reset(); }
+
+RedisStreamSink::RedisStreamSink(QString stream, QString host, quint16 port,
+                                 QString user, QString pass, Level level,
+                                 quint32 batch_size, quint32 flush_interval_ms)
+    : LogSink(level, batch_size, flush_interval_ms),
+      stream(stream),
+      controller(host, port, user, pass) {}
+
+RedisStreamSink::~RedisStreamSink() { this->stop(); }
+
+bool RedisStreamSink::open() {
+    this->controller.connect();
+    return this->controller.getConnected();
+}
+
+bool RedisStreamSink::write(const QList<SinkRecord> &batch) {
+    JDB::RedisPipeline pipeline(this->controller);
+    for (const SinkRecord &record : batch) {
+        pipeline << (JDB::RedisCommand("xadd")
+                     << this->stream << "*" << "time" << record.msecs << "level"
+                     << LEVELS_MAP[record.level] << "message"
+                     << chop_newline(record.content));
+    }
+    if (!pipeline.exec()) return false;
+    for (int i = 0; i < pipeline.size(); ++i) {
+        if (pipeline.isError(i)) return false;
+    }
+    return true;
+}
+
+void RedisStreamSink::close() { this->controller.disconnect(); }
+
+}  // namespace JLogs
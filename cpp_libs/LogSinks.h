@@ -0,0 +1,59 @@
+/*
+ * file name:       LogSinks.h
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#ifndef LOGSINKS_H
+#define LOGSINKS_H
+
+#include <QHostAddress>
+#include <QUdpSocket>
+
+#include "Database.h"
+#include "Logging.h"
+
+namespace JLogs {
+
+class UdpSink : public LogSink {
+   public:
+    UdpSink(QString host = "127.0.0.1", quint16 port = 514,
+            QString app_name = "jlogs", Level level = Level::INFO,
+            quint32 batch_size = 64, quint32 flush_interval_ms = 200);
+    ~UdpSink();
+
+   protected:
+    bool open() override;
+    bool write(const QList<SinkRecord> &batch) override;
+    void close() override;
+
+   private:
+    QString host;
+    quint16 port;
+    QByteArray app_name;
+    QByteArray host_name;
+    std::unique_ptr<QUdpSocket> socket;
+};
+
+class RedisStreamSink : public LogSink {
+   public:
+    RedisStreamSink(QString stream, QString host = "127.0.0.1",
+                    quint16 port = 6379, QString user = "", QString pass = "",
+                    Level level = Level::INFO, quint32 batch_size = 128,
+                    quint32 flush_interval_ms = 200);
+    ~RedisStreamSink();
+
+   protected:
+    bool open() override;
+    bool write(const QList<SinkRecord> &batch) override;
+    void close() override;
+
+   private:
+    QString stream;
+    JDB::RedisController controller;
+};
+
+}  // namespace JLogs
+
+#endif
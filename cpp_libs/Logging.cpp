@@ -7,12 +7,656 @@
 
 #include "Logging.h"
 
+#include <algorithm>
+#include <cmath>
+
 #ifdef Q_OS_WIN32
 #include <Windows.h>
+#else
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
 #endif
 
 namespace JLogs {
-Logger::Logger(QHash<QString, QVariant> config) : config(config) {
+static thread_local Logger* async_writer_owner = nullptr;
+static thread_local Logger* flushing_logger = nullptr;
+
+struct TimeCache {
+    quint64 generation = 0;
+    qint64 bucket = -1;
+    S time_styled;
+    qint64 wall_base = -1;
+    std::chrono::steady_clock::time_point steady_base;
+};
+
+static thread_local TimeCache time_cache;
+static std::atomic<quint64> config_generation{0};
+
+struct StagingSlot {
+    quint64 logger_id;
+    std::shared_ptr<StagingBuffer> buffer;
+};
+
+static const size_t STAGING_SLOTS_SIZE = 16;
+static thread_local std::vector<StagingSlot> staging_slots;
+static std::atomic<quint64> logger_instances{0};
+static std::atomic<quint64> log_sequence{0};
+
+struct SB::Storage {
+    struct Span {
+        qint32 begin, end, style_begin, style_end;
+    };
+
+    QByteArray text, styles;
+    std::vector<Span> spans;
+    std::vector<qint32> ends;
+};
+
+// writes as many whole code points as fit into out and returns the byte count
+static int encode_utf8(const QString& source, char* out, int capacity) {
+    const ushort* utf16 = source.utf16();
+    int size = source.size();
+    int pos = 0;
+    for (int i = 0; i < size; ++i) {
+        quint32 code = utf16[i];
+        int next = i;
+        if (code >= 0xD800 && code < 0xDC00 && i + 1 < size &&
+            utf16[i + 1] >= 0xDC00 && utf16[i + 1] < 0xE000) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (utf16[++next] - 0xDC00);
+        }
+        int width = code < 0x80 ? 1 : code < 0x800 ? 2 : code < 0x10000 ? 3 : 4;
+        if (pos + width > capacity) break;
+        switch (width) {
+            case 1:
+                out[pos] = (char)code;
+                break;
+            case 2:
+                out[pos] = (char)(0xC0 | (code >> 6));
+                out[pos + 1] = (char)(0x80 | (code & 0x3F));
+                break;
+            case 3:
+                out[pos] = (char)(0xE0 | (code >> 12));
+                out[pos + 1] = (char)(0x80 | ((code >> 6) & 0x3F));
+                out[pos + 2] = (char)(0x80 | (code & 0x3F));
+                break;
+            default:
+                out[pos] = (char)(0xF0 | (code >> 18));
+                out[pos + 1] = (char)(0x80 | ((code >> 12) & 0x3F));
+                out[pos + 2] = (char)(0x80 | ((code >> 6) & 0x3F));
+                out[pos + 3] = (char)(0x80 | (code & 0x3F));
+                break;
+        }
+        pos += width;
+        i = next;
+    }
+    return pos;
+}
+
+#ifdef Q_OS_WIN32
+static const int STDOUT_FILENO = 1;
+
+static qint64 write_fully(int, const char* data, qint64 size) {
+    std::cout.flush();
+    qint64 written = std::fwrite(data, 1, size, stdout);
+    std::fflush(stdout);
+    return written;
+}
+
+static qint64 write_staged(QFile& file, const QList<StagedLog>& logs,
+                           const QList<QByteArray>& arenas) {
+    QByteArray joined;
+    for (const StagedLog& log : logs) {
+        joined.append(arenas[log.arena].constData() + log.offset, log.size);
+    }
+    qint64 written = file.write(joined);
+    file.flush();
+    return written;
+}
+#else
+static qint64 write_fully(int fd, const char* data, qint64 size) {
+    if (fd == STDOUT_FILENO) {
+        std::cout.flush();
+        std::fflush(stdout);
+    }
+    qint64 written = 0;
+    while (written < size) {
+        ssize_t result = ::write(fd, data + written, size - written);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return written;
+        }
+        written += result;
+    }
+    return written;
+}
+
+static qint64 write_staged(QFile& file, const QList<StagedLog>& logs,
+                           const QList<QByteArray>& arenas) {
+    std::vector<iovec> vectors;
+    vectors.reserve(logs.size());
+    for (const StagedLog& log : logs) {
+        char* data = (char*)arenas[log.arena].constData() + log.offset;
+        if (!vectors.empty() &&
+            (char*)vectors.back().iov_base + vectors.back().iov_len == data) {
+            vectors.back().iov_len += log.size;
+        } else {
+            vectors.push_back({data, (size_t)log.size});
+        }
+    }
+
+    file.flush();
+    int fd = file.handle();
+    qint64 written = 0;
+    size_t index = 0;
+    while (index < vectors.size()) {
+        int count = (int)qMin(vectors.size() - index, (size_t)IOV_MAX);
+        ssize_t result = ::writev(fd, vectors.data() + index, count);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return written;
+        }
+        written += result;
+        while (index < vectors.size() &&
+               (size_t)result >= vectors[index].iov_len) {
+            result -= vectors[index].iov_len;
+            ++index;
+        }
+        if (result > 0) {
+            vectors[index].iov_base = (char*)vectors[index].iov_base + result;
+            vectors[index].iov_len -= result;
+        }
+    }
+    return written;
+}
+#endif
+
+static const char JSON_HEX[] = "0123456789abcdef";
+static thread_local QByteArray json_scratch;
+
+static void json_put_text(QByteArray& out, const char* data, int size) {
+    out.append('"');
+    int start = 0;
+    for (int i = 0; i < size; ++i) {
+        quint8 code = data[i];
+        if (code >= 0x20 && code != '"' && code != '\\') continue;
+        out.append(data + start, i - start);
+        start = i + 1;
+        switch (code) {
+            case '"':
+                out.append("\\\"", 2);
+                break;
+            case '\\':
+                out.append("\\\\", 2);
+                break;
+            case '\n':
+                out.append("\\n", 2);
+                break;
+            case '\r':
+                out.append("\\r", 2);
+                break;
+            case '\t':
+                out.append("\\t", 2);
+                break;
+            default: {
+                char escape[6] = {'\\', 'u', '0', '0', JSON_HEX[code >> 4],
+                                  JSON_HEX[code & 0xF]};
+                out.append(escape, 6);
+            }
+        }
+    }
+    out.append(data + start, size - start);
+    out.append('"');
+}
+
+static void json_put_text(QByteArray& out, const QString& text) {
+    json_scratch.resize(text.size() * 3);
+    int size = encode_utf8(text, json_scratch.data(), json_scratch.size());
+    json_put_text(out, json_scratch.constData(), size);
+}
+
+static void json_put_uint(QByteArray& out, quint64 value) {
+    char digits[20];
+    int pos = 20;
+    do {
+        digits[--pos] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    out.append(digits + pos, 20 - pos);
+}
+
+static void json_put_int(QByteArray& out, qint64 value) {
+    if (value < 0) {
+        out.append('-');
+        json_put_uint(out, 0 - (quint64)value);
+    } else {
+        json_put_uint(out, (quint64)value);
+    }
+}
+
+static void json_put_double(QByteArray& out, double value) {
+    if (!std::isfinite(value)) {
+        out.append("null", 4);
+        return;
+    }
+    char digits[32];
+    int size = std::snprintf(digits, sizeof(digits), "%.15g", value);
+    if (std::strtod(digits, nullptr) != value) {
+        size = std::snprintf(digits, sizeof(digits), "%.17g", value);
+    }
+    out.append(digits, size);
+}
+
+static void json_put_digits(char* out, int value, int width) {
+    for (int i = width - 1; i >= 0; --i) {
+        out[i] = (char)('0' + value % 10);
+        value /= 10;
+    }
+}
+
+static void json_put_time(QByteArray& out, qint64 msecs) {
+    qint64 days = msecs / 86400000;
+    qint64 rest = msecs % 86400000;
+    if (rest < 0) {
+        rest += 86400000;
+        days -= 1;
+    }
+    days += 719468;
+    qint64 era = (days >= 0 ? days : days - 146096) / 146097;
+    qint64 day_of_era = days - era * 146097;
+    qint64 year_of_era = (day_of_era - day_of_era / 1460 +
+                          day_of_era / 36524 - day_of_era / 146096) /
+                         365;
+    qint64 day_of_year =
+        day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    qint64 month_index = (5 * day_of_year + 2) / 153;
+    int day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    int month = month_index < 10 ? month_index + 3 : month_index - 9;
+    int year = year_of_era + era * 400 + (month <= 2);
+
+    char text[26] = "\"0000-00-00T00:00:00.000Z";
+    json_put_digits(text + 1, year, 4);
+    json_put_digits(text + 6, month, 2);
+    json_put_digits(text + 9, day, 2);
+    json_put_digits(text + 12, rest / 3600000, 2);
+    json_put_digits(text + 15, rest / 60000 % 60, 2);
+    json_put_digits(text + 18, rest / 1000 % 60, 2);
+    json_put_digits(text + 21, rest % 1000, 3);
+    out.append(text, 25);
+    out.append('"');
+}
+
+static void json_put_field(QByteArray& out, const LogField& field) {
+    out.append(',');
+    json_put_text(out, field.key, (int)strlen(field.key));
+    out.append(':');
+    switch (field.type) {
+        case LogField::INT:
+            json_put_int(out, field.i);
+            break;
+        case LogField::UINT:
+            json_put_uint(out, field.u);
+            break;
+        case LogField::DOUBLE:
+            json_put_double(out, field.d);
+            break;
+        case LogField::BOOL:
+            field.b ? out.append("true", 4) : out.append("false", 5);
+            break;
+        case LogField::TEXT:
+            json_put_text(out, field.text.data, field.text.size);
+            break;
+        case LogField::STRING:
+            json_put_text(out, *field.string);
+            break;
+    }
+}
+
+static void text_put_field(SB& out, const LogField& field) {
+    out << " " << field.key << "=";
+    switch (field.type) {
+        case LogField::INT:
+            out << field.i;
+            break;
+        case LogField::UINT:
+            out << field.u;
+            break;
+        case LogField::DOUBLE:
+            out << field.d;
+            break;
+        case LogField::BOOL:
+            out << field.b;
+            break;
+        case LogField::TEXT:
+            out << QByteArray::fromRawData(field.text.data, field.text.size);
+            break;
+        case LogField::STRING:
+            out << *field.string;
+            break;
+    }
+}
+
+static double random_unit() {
+    static thread_local quint64 state =
+        (quint64)std::chrono::steady_clock::now().time_since_epoch().count() ^
+        (quint64)(quintptr)&state;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return (state >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static const size_t SB_POOL_SIZE = 16;
+static const int SB_RESERVE_SIZE = 256;
+
+// an SB can outlive its thread's pool (a static SB, or one destroyed by
+// another thread_local at thread exit). the flag is trivially destructible so
+// it stays readable after the pool is gone, and SB falls back to new/delete.
+static thread_local bool sb_pool_destroyed = false;
+
+struct SBPool {
+    std::vector<std::unique_ptr<SB::Storage>> storage;
+    ~SBPool() { sb_pool_destroyed = true; }
+};
+static thread_local SBPool sb_pool;
+
+static std::mutex format_registry_lock;
+static QList<QByteArray> format_registry;
+static thread_local QByteArray binary_scratch;
+
+static void binary_put_format(QByteArray& out, quint32 format_id,
+                              const QByteArray& format) {
+    out.append((char)BinaryRecordType::FORMAT_RECORD);
+    binary_put_le(out, format_id, 4);
+    binary_put_le(out, (quint32)format.size(), 4);
+    out.append(format);
+}
+
+static const qint64 GZIP_CHUNK_SIZE = 8 * 1024 * 1024;
+
+static quint32 crc32_update(quint32 crc, const char* data, qint64 size) {
+    static quint32 table[256] = {0};
+    static std::once_flag table_ready;
+    std::call_once(table_ready, [] {
+        for (quint32 i = 0; i < 256; ++i) {
+            quint32 c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+            }
+            table[i] = c;
+        }
+    });
+    crc = ~crc;
+    for (qint64 i = 0; i < size; ++i) {
+        crc = table[(crc ^ (quint8)data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static void append_le32(QByteArray& out, quint32 value) {
+    for (int i = 0; i < 4; ++i) {
+        out.append((char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+// qCompress() emits a 4-byte length, a 2-byte zlib header, the raw deflate
+// stream and a 4-byte adler32; rewrapping the deflate stream with a gzip
+// header/trailer gives a member that gzip/zcat can read.
+static QByteArray gzip_member(const QByteArray& chunk) {
+    static const char header[10] = {'\x1f', '\x8b', 8, 0, 0,
+                                    0,      0,      0, 0, '\xff'};
+    QByteArray zlib = qCompress(chunk, 6);
+    QByteArray member;
+    member.reserve(zlib.size() + 12);
+    member.append(header, 10);
+    member.append(zlib.constData() + 6, zlib.size() - 10);
+    append_le32(member, crc32_update(0, chunk.constData(), chunk.size()));
+    append_le32(member, (quint32)chunk.size());
+    return member;
+}
+
+static bool compress_log_file(const QString& path) {
+    QFile source(path);
+    if (source.size() == 0 || !source.open(QIODevice::ReadOnly)) return false;
+    QFile target(path + ".gz");
+    if (!target.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+    while (!source.atEnd()) {
+        QByteArray chunk = source.read(GZIP_CHUNK_SIZE);
+        if (chunk.isEmpty()) break;
+        if (target.write(gzip_member(chunk)) < 0) {
+            target.close();
+            target.remove();
+            return false;
+        }
+    }
+    target.close();
+    source.close();
+    QFile::remove(path + LOG_INDEX_SUFFIX);
+    return source.remove();
+}
+
+static void prune_log_files(const RotationJob& job) {
+    if (job.keep_files <= 0) return;
+    QDir dir(job.stored_path.isEmpty() ? "." : job.stored_path);
+    QRegularExpression pattern(
+        "^" + QRegularExpression::escape(job.name) +
+        (job.date_format.isEmpty() ? "" : "_(.+?)") + "(?:\\.\\d+)?\\." +
+        QRegularExpression::escape(job.suffix) + "(?:\\.gz)?$");
+    QString current = QFileInfo(job.current_path).fileName();
+    qint32 kept = 0;
+    QStringList files =
+        dir.entryList(QStringList{job.name + "*"}, QDir::Files, QDir::Time);
+    for (const QString& file : files) {
+        if (file == current) continue;
+        QRegularExpressionMatch match = pattern.match(file);
+        if (!match.hasMatch()) continue;
+        if (!job.date_format.isEmpty() &&
+            !QDate::fromString(match.captured(1), job.date_format).isValid()) {
+            continue;
+        }
+        if (++kept > job.keep_files) {
+            dir.remove(file);
+            dir.remove(file + LOG_INDEX_SUFFIX);
+        }
+    }
+}
+
+S::S(const SB& rvalue) {
+    this->rawStr = QString::fromUtf8(rvalue.raw());
+    this->styStr = QString::fromUtf8(rvalue.styledBytes());
+}
+
+SB::SB(const SB& rvalue) { this->append(rvalue); }
+
+SB::~SB() {
+    if (this->storage == nullptr) return;
+    if (!sb_pool_destroyed && sb_pool.storage.size() < SB_POOL_SIZE) {
+        this->storage->text.resize(0);
+        this->storage->styles.resize(0);
+        this->storage->spans.clear();
+        sb_pool.storage.emplace_back(this->storage);
+    } else {
+        delete this->storage;
+    }
+}
+
+SB& SB::operator=(const SB& rvalue) {
+    if (this != &rvalue) {
+        this->clear();
+        this->append(rvalue);
+    }
+    return *this;
+}
+
+SB& SB::operator=(SB&& rvalue) {
+    std::swap(this->storage, rvalue.storage);
+    return *this;
+}
+
+bool SB::isEmpty() const {
+    return this->storage == nullptr || this->storage->text.isEmpty();
+}
+
+void SB::clear() {
+    if (this->storage == nullptr) return;
+    this->storage->text.resize(0);
+    this->storage->styles.resize(0);
+    this->storage->spans.clear();
+}
+
+const QByteArray& SB::raw() const {
+    static const QByteArray empty;
+    return this->storage == nullptr ? empty : this->storage->text;
+}
+
+void SB::appendRaw(QByteArray& out) const { out.append(this->raw()); }
+
+void SB::appendStyled(QByteArray& out) const {
+    if (this->storage == nullptr) return;
+    const QByteArray& text = this->storage->text;
+    const QByteArray& styles = this->storage->styles;
+    std::vector<qint32>& ends = this->storage->ends;
+    qint32 pos = 0;
+    ends.clear();
+    for (const Storage::Span& span : this->storage->spans) {
+        while (!ends.empty() && ends.back() <= span.begin) {
+            out.append(text.constData() + pos, ends.back() - pos);
+            out.append(CLEAR);
+            pos = ends.back();
+            ends.pop_back();
+        }
+        out.append(text.constData() + pos, span.begin - pos);
+        out.append(styles.constData() + span.style_begin,
+                   span.style_end - span.style_begin);
+        pos = span.begin;
+        ends.push_back(span.end);
+    }
+    while (!ends.empty()) {
+        out.append(text.constData() + pos, ends.back() - pos);
+        out.append(CLEAR);
+        pos = ends.back();
+        ends.pop_back();
+    }
+    out.append(text.constData() + pos, text.size() - pos);
+}
+
+QByteArray SB::styledBytes() const {
+    QByteArray out;
+    this->appendStyled(out);
+    return out;
+}
+
+SB::Storage& SB::data() {
+    if (this->storage == nullptr) {
+        if (sb_pool_destroyed || sb_pool.storage.empty()) {
+            this->storage = new Storage;
+            this->storage->text.reserve(SB_RESERVE_SIZE);
+            this->storage->styles.reserve(SB_RESERVE_SIZE);
+        } else {
+            this->storage = sb_pool.storage.back().release();
+            sb_pool.storage.pop_back();
+        }
+    }
+    return *this->storage;
+}
+
+int SB::open_span() {
+    Storage& data = this->data();
+    Storage::Span span;
+    span.begin = span.end = data.text.size();
+    span.style_begin = span.style_end = data.styles.size();
+    data.spans.push_back(span);
+    return (int)data.spans.size() - 1;
+}
+
+void SB::add_style(int span, const char* style) {
+    Storage& data = this->data();
+    data.styles.append(style);
+    data.spans[span].style_end = data.styles.size();
+}
+
+void SB::add_style(int span, const QString& style) {
+    Storage& data = this->data();
+    data.styles.append(style.toUtf8());
+    data.spans[span].style_end = data.styles.size();
+}
+
+void SB::close_span(int span) {
+    Storage& data = this->data();
+    data.spans[span].end = data.text.size();
+}
+
+void SB::append(const SB& rvalue) {
+    if (rvalue.storage == nullptr) return;
+    Storage& data = this->data();
+    qint32 text_offset = data.text.size();
+    qint32 style_offset = data.styles.size();
+    data.text.append(rvalue.storage->text);
+    data.styles.append(rvalue.storage->styles);
+    for (Storage::Span span : rvalue.storage->spans) {
+        span.begin += text_offset;
+        span.end += text_offset;
+        span.style_begin += style_offset;
+        span.style_end += style_offset;
+        data.spans.push_back(span);
+    }
+}
+
+void SB::append(const char* rvalue) { this->data().text.append(rvalue); }
+
+void SB::append(const QString& rvalue) {
+    QByteArray& text = this->data().text;
+    int offset = text.size();
+    int capacity = rvalue.size() * 3;
+    text.resize(offset + capacity);
+    text.resize(offset + encode_utf8(rvalue, text.data() + offset, capacity));
+}
+
+void SB::append(const QByteArray& rvalue) { this->data().text.append(rvalue); }
+
+void SB::append(const std::string& rvalue) {
+    this->data().text.append(rvalue.data(), (int)rvalue.size());
+}
+
+void SB::append(char rvalue) { this->data().text.append(rvalue); }
+
+void SB::append(bool rvalue) {
+    this->data().text.append(rvalue ? "true" : "false");
+}
+
+void SB::append_int(qint64 rvalue) {
+    if (rvalue < 0) {
+        this->data().text.append('-');
+        this->append_uint(0 - (quint64)rvalue);
+    } else {
+        this->append_uint((quint64)rvalue);
+    }
+}
+
+void SB::append_uint(quint64 rvalue) {
+    char digits[20];
+    int pos = 20;
+    do {
+        digits[--pos] = (char)('0' + rvalue % 10);
+        rvalue /= 10;
+    } while (rvalue != 0);
+    this->data().text.append(digits + pos, 20 - pos);
+}
+
+void SB::append_float(double rvalue, int precision) {
+    char digits[32];
+    int size = std::snprintf(digits, sizeof(digits), "%.*g", precision, rvalue);
+    if (std::strtod(digits, nullptr) != rvalue) {
+        size = std::snprintf(digits, sizeof(digits), "%.*g", precision + 2,
+                             rvalue);
+    }
+    this->data().text.append(digits, size);
+}
+
+Logger::Logger(QHash<QString, QVariant> config)
+    : config(config), instance_id(++logger_instances) {
 #ifdef Q_OS_WIN32
     HANDLE hOut = GetStdHandle(STD_OUTPUT_HANDLE);
     DWORD dwMode = 0;
@@ -20,36 +664,277 @@ Logger::Logger(QHash<QString, QVariant> config) : config(config) {
     dwMode |= 4;
     SetConsoleMode(hOut, dwMode);
 #endif
+    this->compile_config();
+    this->open_flight_recorder();
+    if (this->getConfig("async_mode", false).toBool()) {
+        this->start_async();
+    }
 }
 
-Logger::~Logger() {}
+Logger::~Logger() { this->shutdown(); }
 
 QVariant Logger::getConfig(QString key) {
+    std::lock_guard<std::mutex> guard(this->config_lock);
     if (!this->config.contains(key)) throw "invalid key: " + key.toStdString();
-    return this->config[key];
+    return this->config.value(key);
 }
 
 QVariant Logger::getConfig(QString key, QVariant repl) {
-    if (!this->config.contains(key)) return repl;
-    return this->config[key];
+    std::lock_guard<std::mutex> guard(this->config_lock);
+    return this->config.value(key, repl);
 }
 
 bool Logger::setConfig(QString key, QVariant value) {
-    if (this->config.contains(key)) {
-        this->config[key] = value;
+    std::lock_guard<std::mutex> writer(this->config_write_lock);
+    bool known = false;
+    {
+        std::lock_guard<std::mutex> guard(this->config_lock);
+        known = this->config.contains(key);
+        if (known) this->config[key] = value;
+    }
+    if (known) {
+        this->compile_config();
+        if (key.startsWith("flight_recorder")) {
+            this->open_flight_recorder();
+        }
+        if (key.startsWith("log_")) {
+            this->log_io_stale.store(true);
+            this->binary_io_stale.store(true);
+        } else if (key.startsWith("binary_log")) {
+            this->binary_io_stale.store(true);
+        }
+        if (key == "async_mode") {
+            value.toBool() ? this->start_async() : this->stop_async();
+        } else if (key == "async_overflow_policy") {
+            this->async_policy.store(value.toUInt());
+        }
         return true;
     }
     return false;
 }
 
 void Logger::log(const S& content, Level level, Tag tag, bool ignore_buffer) {
-    S log_content = this->make_prefix_styled(level, tag) + content + "\n";
-    if (level >= this->getConfig("log_print_level").toUInt()) {
-        std::cout << (std::string)log_content;
+    if (!this->isEnabled(level)) return;
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    if (!this->admit(compiled, content.rawStr, level, tag)) return;
+    this->log_formatted(compiled, content, level, tag, ignore_buffer);
+}
+
+void Logger::log_formatted(const CompiledLogConfig& compiled,
+                           const S& content, Level level, Tag tag,
+                           bool ignore_buffer, QByteArray json) {
+    qint64 msecs = this->current_msecs(compiled);
+    S log_content =
+        this->make_prefix_styled(compiled, level, tag, msecs) + content + "\n";
+    if (json.isEmpty() && this->json_wanted(compiled, level, ignore_buffer)) {
+        QByteArray message = content.rawStr.toUtf8();
+        this->json_line(compiled, json, level, tag, message.constData(),
+                        message.size(), nullptr, 0);
     }
-    if (!ignore_buffer) {
-        this->add_log_to_buffer(level, log_content);
+    FlightRecorder* flight_recorder = this->flight_recorder.load();
+    if (flight_recorder != nullptr &&
+        level >= compiled.flight_recorder_level) {
+        flight_recorder->record(msecs, level, tag, log_content.rawStr);
+    }
+    if (async_writer_owner != this) {
+        this->async_producers.fetch_add(1);
+        if (this->async_running.load()) {
+            LogRecord record;
+            record.content = log_content;
+            record.json = json;
+            record.level = level;
+            record.ignore_buffer = ignore_buffer;
+            record.msecs = msecs;
+            this->enqueue_log(record);
+            this->async_producers.fetch_sub(1);
+            return;
+        }
+        this->async_producers.fetch_sub(1);
     }
+    this->write_log(compiled, log_content, level, ignore_buffer, json, msecs);
+}
+
+void Logger::logFields(Level level, Tag tag, const char* message,
+                       std::initializer_list<LogField> fields) {
+    if (!this->isEnabled(level)) return;
+    SB text(message);
+    for (const LogField& field : fields) {
+        text_put_field(text, field);
+    }
+    S rendered(text);
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    if (!this->admit(compiled, rendered.rawStr, level, tag)) return;
+    QByteArray json;
+    if (this->json_wanted(compiled, level, false)) {
+        this->json_line(compiled, json, level, tag, message,
+                        (int)strlen(message), fields.begin(),
+                        (int)fields.size());
+    }
+    this->log_formatted(compiled, rendered, level, tag, false, json);
+}
+
+void Logger::logFields(Level level, const char* message,
+                       std::initializer_list<LogField> fields) {
+    this->logFields(level, Tag::NO_TAG, message, fields);
+}
+
+void Logger::json_line(const CompiledLogConfig& compiled, QByteArray& out,
+                       Level level, Tag tag, const char* message, int size,
+                       const LogField* fields, int field_count) {
+    out.reserve(64 + size + field_count * 24);
+    out.append("{\"time\":", 8);
+    json_put_time(out, this->current_msecs(compiled));
+    out.append(compiled.json_levels[level]);
+    out.append(compiled.json_tags[tag]);
+    out.append(",\"msg\":", 7);
+    json_put_text(out, message, size);
+    for (int i = 0; i < field_count; ++i) {
+        json_put_field(out, fields[i]);
+    }
+    out.append("}\n", 2);
+}
+
+void Logger::log(const SB& content, Level level, Tag tag, bool ignore_buffer) {
+    if (!this->isEnabled(level)) return;
+    S rendered;
+    rendered.rawStr = QString::fromUtf8(content.raw());
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    if (!this->admit(compiled, rendered.rawStr, level, tag)) return;
+    if ((level >= compiled.log_print_level && compiled.colored_display) ||
+        level >= this->sinks_level.load(std::memory_order_relaxed)) {
+        rendered.styStr = QString::fromUtf8(content.styledBytes());
+    }
+    this->log_formatted(compiled, rendered, level, tag, ignore_buffer);
+}
+
+bool Logger::admitCallSite(LogCallSite& site, quint32 per_second) {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    if (per_second == 0) {
+        per_second = compiled.rate_limit_per_second;
+    }
+    if (per_second == 0) return true;
+
+    qint64 window = this->current_msecs(compiled) / 1000;
+    qint64 current = site.window.load(std::memory_order_relaxed);
+    if (current != window &&
+        site.window.compare_exchange_strong(current, window)) {
+        site.count.store(0);
+    }
+    if (site.count.fetch_add(1) < per_second) return true;
+
+    if (site.suppressed.fetch_add(1) == 0) {
+        std::lock_guard<std::mutex> guard(this->suppress_lock);
+        this->suppressed_sites.push_back(&site);
+    }
+    this->has_suppressed.store(true, std::memory_order_relaxed);
+    return false;
+}
+
+bool Logger::admit(const CompiledLogConfig& compiled, const QString& content,
+                   Level level, Tag tag) {
+    if (this->has_suppressed.load(std::memory_order_relaxed)) {
+        qint64 second = this->current_msecs(compiled) / 1000;
+        qint64 last = this->last_report.load(std::memory_order_relaxed);
+        if (second != last &&
+            this->last_report.compare_exchange_strong(last, second)) {
+            this->report_suppressed();
+        }
+    }
+
+    double sample_rate = compiled.sample_rates[level];
+    if (sample_rate < 1.0 && random_unit() >= sample_rate) {
+        this->sampled_out.fetch_add(1);
+        this->has_suppressed.store(true, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (!compiled.dedup_repeated) return true;
+    quint64 repeats = 0;
+    Level repeated_level;
+    {
+        std::lock_guard<std::mutex> guard(this->suppress_lock);
+        if (level == this->dedup_level && tag == this->dedup_tag &&
+            content == this->dedup_content) {
+            this->dedup_repeats += 1;
+            this->has_suppressed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        repeats = this->dedup_repeats;
+        repeated_level = this->dedup_level;
+        this->dedup_content = content;
+        this->dedup_level = level;
+        this->dedup_tag = tag;
+        this->dedup_repeats = 0;
+    }
+    if (repeats > 0) {
+        this->log_formatted(compiled,
+                            S("last message repeated ") + S(repeats) + " times",
+                            repeated_level, Tag::NO_TAG, false);
+    }
+    return true;
+}
+
+void Logger::report_suppressed() {
+    QList<LogCallSite*> sites;
+    quint64 repeats = 0;
+    Level repeated_level;
+    {
+        std::lock_guard<std::mutex> guard(this->suppress_lock);
+        sites.swap(this->suppressed_sites);
+        repeats = this->dedup_repeats;
+        repeated_level = this->dedup_level;
+        this->dedup_repeats = 0;
+    }
+    this->has_suppressed.store(false, std::memory_order_relaxed);
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+
+    if (repeats > 0) {
+        this->log_formatted(compiled,
+                            S("last message repeated ") + S(repeats) + " times",
+                            repeated_level, Tag::NO_TAG, false);
+    }
+    for (LogCallSite* site : sites) {
+        quint64 suppressed = site->suppressed.exchange(0);
+        if (suppressed > 0) {
+            this->log_formatted(compiled,
+                                S("suppressed ") + S(suppressed, BRIGHT_RED) +
+                                    " messages from " + site->file + ":" +
+                                    site->line,
+                                Level::WARN, Tag::NO_TAG, false);
+        }
+    }
+    quint64 sampled = this->sampled_out.exchange(0);
+    if (sampled > 0) {
+        this->log_formatted(compiled,
+                            S("dropped ") + S(sampled) +
+                                " debug/info messages by sampling",
+                            Level::INFO, Tag::NO_TAG, false);
+    }
+}
+
+void Logger::debug(const SB& content, Tag tag, bool ignore_buffer) {
+    this->log(content, Level::DEBUG, tag, ignore_buffer);
+}
+
+void Logger::info(const SB& content, Tag tag, bool ignore_buffer) {
+    this->log(content, Level::INFO, tag, ignore_buffer);
+}
+
+void Logger::warn(const SB& content, Tag tag, bool ignore_buffer) {
+    this->log(content, Level::WARN, tag, ignore_buffer);
+}
+
+void Logger::error(const SB& content, Tag tag, bool ignore_buffer) {
+    this->log(content, Level::ERR, tag, ignore_buffer);
+}
+
+void Logger::critical(const SB& content, Tag tag, bool ignore_buffer) {
+    this->log(content, Level::CRIT, tag, ignore_buffer);
 }
 
 void Logger::debug(const S& content, Tag tag, bool ignore_buffer) {
@@ -72,102 +957,1047 @@ void Logger::critical(const S& content, Tag tag, bool ignore_buffer) {
     this->log(content, Level::CRIT, tag, ignore_buffer);
 }
 
+void Logger::shutdown() {
+    this->report_suppressed();
+    this->stop_async();
+    this->clearSinks();
+    if (this->staged_count.load() > 0) {
+        try {
+            this->flushNow();
+        } catch (...) {
+        }
+    }
+    this->lock.lock();
+    this->close_index_file();
+    this->log_io.close();
+    this->binary_io.close();
+    this->lock.unlock();
+    this->stop_rotation_worker();
+}
+
+quint64 Logger::droppedLogs() const { return this->async_dropped.load(); }
+
+quint32 Logger::registerFormat(const QString& format) {
+    std::lock_guard<std::mutex> guard(format_registry_lock);
+    format_registry.push_back(format.toUtf8());
+    return format_registry.size() - 1;
+}
+
 void Logger::flushNow() {
+    if (this->async_running.load() && async_writer_owner != this) {
+        quint64 target = this->async_pushed.load();
+        std::unique_lock<std::mutex> guard(this->async_progress_lock);
+        this->async_waiters.fetch_add(1);
+        while (this->async_done.load() < target) {
+            this->wake_writer();
+            this->async_progress_cv.wait_for(guard,
+                                             std::chrono::milliseconds(10));
+        }
+        this->async_waiters.fetch_sub(1);
+    }
+    this->flush_staged();
+}
+
+void Logger::flush_staged() {
     this->lock.lock();
-    if (this->getConfig("file_log").toBool()) {
-        QFile log_file(
-            this->getConfig("log_styledtored_path").toString() +
-            this->getConfig("log_name").toString() + "_" +
-            QDateTime().currentDateTime().toString(
-                this->getConfig("log_add_date_to_styleduffix").toBool()
-                    ? this->getConfig("log_filename_date_format_styledtr")
-                          .toString()
-                    : "") +
-            "." + this->getConfig("log_styleduffix").toString());
-        if (log_file.open(this->getConfig("log_append").toBool()
-                              ? QIODevice::Append
-                              : QIODevice::Truncate)) {
-            for (QString& log : this->log_buffer) {
-                log_file.write(log.toUtf8());
+    flushing_logger = this;
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    qint32 failed = 0;
+    QList<StagedLog> logs;
+    QList<QByteArray> arenas;
+    QByteArray binary;
+    this->collect_staged(logs, arenas, binary);
+
+    if (!binary.isEmpty() && this->open_binary_file()) {
+        QByteArray formats;
+        {
+            std::lock_guard<std::mutex> guard(format_registry_lock);
+            for (int i = 0; i < format_registry.size(); ++i) {
+                if (!this->binary_defined.contains(i)) {
+                    binary_put_format(formats, i, format_registry[i]);
+                    this->binary_defined.insert(i);
+                }
+            }
+        }
+        this->binary_io.write(formats);
+        this->binary_io.write(binary);
+        this->binary_io.flush();
+    }
+
+    if (compiled.file_log && !logs.isEmpty()) {
+        if (this->open_log_file()) {
+            std::sort(logs.begin(), logs.end(),
+                      [](const StagedLog& lvalue, const StagedLog& rvalue) {
+                          return lvalue.msecs != rvalue.msecs
+                                     ? lvalue.msecs < rvalue.msecs
+                                     : lvalue.sequence < rvalue.sequence;
+                      });
+            qint64 offset = this->log_io_size;
+            qint64 written = write_staged(this->log_io, logs, arenas);
+            if (written > 0) this->log_io_size += written;
+            if (compiled.log_index && written > 0) {
+                this->index_logs(logs, offset, written);
+            }
+            if (compiled.log_rotate_size > 0 &&
+                this->log_io_size >= compiled.log_rotate_size) {
+                this->rotate_log_file();
             }
         } else {
-            this->log(S("failed to flush ") +
-                          S(this->log_buffer.size(), BRIGHT_RED) +
-                          "logs to disk.",
-                      Level::ERR, Tag::FAILED, true);
+            failed = logs.size();
         }
-        log_file.close();
     }
-    this->drop_logs();
+    flushing_logger = nullptr;
     this->lock.unlock();
+    if (failed > 0) {
+        this->log(S("failed to flush ") + S(failed, BRIGHT_RED) +
+                      "logs to disk.",
+                  Level::ERR, Tag::FAILED, true);
+    }
+    this->flush_console();
+}
+
+void Logger::index_logs(const QList<StagedLog>& logs, qint64 offset,
+                        qint64 written) {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    LogIndexEntry& block = this->index_block;
+    qint64 end = offset + written;
+    for (const StagedLog& log : logs) {
+        if (offset + log.size > end) break;
+        if (block.records > 0 &&
+            offset != (qint64)(block.offset + block.size)) {
+            this->write_index_block();
+        }
+        if (block.records == 0) {
+            block.offset = offset;
+            block.first_msecs = block.last_msecs = log.msecs;
+        }
+        block.first_msecs = qMin(block.first_msecs, log.msecs);
+        block.last_msecs = qMax(block.last_msecs, log.msecs);
+        block.levels[log.level] += 1;
+        block.records += 1;
+        block.size += log.size;
+        offset += log.size;
+        if ((qint32)block.records >= compiled.log_index_interval) {
+            this->write_index_block();
+        }
+    }
 }
 
-S Logger::make_prefix_styled(Level level, Tag tag) {
-    return S(this->getConfig("display_time").toBool() ? this->make_time_styled()
-                                                      : "") +
-           (this->getConfig("display_time").toBool() ? " " : "") +
-           S(this->getConfig("display_levels").toBool()
-                 ? this->make_level_styled(level)
-                 : "") +
-           (this->getConfig("display_levels").toBool() ? " " : "") +
-           S(this->getConfig("display_tags").toBool()
-                 ? this->make_tag_styled(tag)
-                 : "") +
-           ((this->getConfig("display_tags").toBool() && tag != Tag::NO_TAG)
-                ? " "
-                : "");
-}
-
-S Logger::make_time_styled() {
-    return (S((this->getConfig("time_quote").toBool()
-                   ? this->getConfig("time_quote_begin").toString()
-                   : ""),
-              this->getConfig("time_quote_fore").toString(),
-              this->getConfig("time_quote_back").toString()) +
-            S(QDateTime().currentDateTime().toString(
-                  this->getConfig("time_format").toString()),
-              this->getConfig("time_fore").toString(),
-              this->getConfig("time_back").toString()) +
-            S((this->getConfig("time_quote").toBool()
-                   ? this->getConfig("time_quote_end").toString()
-                   : ""),
-              this->getConfig("time_quote_fore").toString(),
-              this->getConfig("time_quote_back").toString()));
+void Logger::write_index_block() {
+    if (!this->index_io.isOpen()) {
+        this->index_io.setFileName(this->log_io.fileName() + LOG_INDEX_SUFFIX);
+        if (this->index_io.open(QIODevice::Append) &&
+            this->index_io.size() == 0) {
+            this->index_io.write(LOG_INDEX_MAGIC);
+        }
+    }
+    if (this->index_io.isOpen()) {
+        this->index_io.write((const char*)&this->index_block,
+                             sizeof(LogIndexEntry));
+        this->index_io.flush();
+    }
+    this->index_block = LogIndexEntry();
+}
+
+void Logger::close_index_file() {
+    if (this->index_block.records > 0) {
+        this->write_index_block();
+    }
+    this->index_io.close();
+}
+
+void Logger::flush_console() {
+    std::lock_guard<std::mutex> guard(this->console_lock);
+    if (this->console_batch.isEmpty()) return;
+    write_fully(STDOUT_FILENO, this->console_batch.constData(),
+                this->console_batch.size());
+    this->console_batch.resize(0);
+}
+
+S Logger::make_prefix_styled(const CompiledLogConfig& compiled, Level level,
+                             Tag tag, qint64 msecs) {
+    const S& fixed = compiled.prefixes[level][tag];
+    if (!compiled.display_time) return fixed;
+    S prefix = this->make_time_styled(compiled, msecs);
+    prefix.rawStr += " ";
+    prefix.rawStr += fixed.rawStr;
+    prefix.styStr += " ";
+    prefix.styStr += fixed.styStr;
+    return prefix;
+}
+
+S Logger::make_time_styled(const CompiledLogConfig& compiled, qint64 msecs) {
+    TimeCache& cache = time_cache;
+    qint64 bucket = msecs / compiled.time_resolution_ms;
+    if (cache.generation == compiled.generation && cache.bucket == bucket) {
+        return cache.time_styled;
+    }
+
+    QString now =
+        QDateTime::fromMSecsSinceEpoch(bucket * compiled.time_resolution_ms)
+            .toString(compiled.time_format);
+    cache.time_styled.rawStr =
+        compiled.time_open.rawStr + now + compiled.time_close.rawStr;
+    cache.time_styled.styStr = compiled.time_open.styStr +
+                               compiled.time_style + now + CLEAR +
+                               compiled.time_close.styStr;
+    cache.generation = compiled.generation;
+    cache.bucket = bucket;
+    return cache.time_styled;
+}
+
+qint64 Logger::current_msecs(const CompiledLogConfig& compiled) {
+    if (!compiled.time_monotonic) {
+        return QDateTime::currentMSecsSinceEpoch();
+    }
+    TimeCache& cache = time_cache;
+    std::chrono::steady_clock::time_point now =
+        std::chrono::steady_clock::now();
+    qint64 elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+                         now - cache.steady_base)
+                         .count();
+    if (cache.wall_base < 0 ||
+        elapsed >= compiled.time_resync_interval_ms) {
+        cache.wall_base = QDateTime::currentMSecsSinceEpoch();
+        cache.steady_base = now;
+        return cache.wall_base;
+    }
+    return cache.wall_base + elapsed;
 }
 
 S Logger::make_level_styled(Level level) {
-    return S(this->getConfig(QString("level_%1_text").arg(LEVELS_MAP[level]))
-                 .toString(),
-             this->getConfig(QString("level_%1_fore").arg(LEVELS_MAP[level]))
-                 .toString(),
-             this->getConfig(QString("level_%1_back").arg(LEVELS_MAP[level]))
-                 .toString());
+    const QString& name = LEVELS_MAP[level];
+    return S(this->config_value(QString("level_%1_text").arg(name)).toString(),
+             this->config_value(QString("level_%1_fore").arg(name)).toString(),
+             this->config_value(QString("level_%1_back").arg(name)).toString());
 }
 
 S Logger::make_tag_styled(Tag tag) {
     if (tag == Tag::NO_TAG) return S();
 
-    return S(
-        this->getConfig(QString("tag_%1_text").arg(TAGS_MAP[tag])).toString(),
-        this->getConfig(QString("tag_%1_fore").arg(TAGS_MAP[tag])).toString(),
-        this->getConfig(QString("tag_%1_back").arg(TAGS_MAP[tag])).toString());
+    const QString& name = TAGS_MAP[tag];
+    return S(this->config_value(QString("tag_%1_text").arg(name)).toString(),
+             this->config_value(QString("tag_%1_fore").arg(name)).toString(),
+             this->config_value(QString("tag_%1_back").arg(name)).toString());
+}
+
+QVariant Logger::config_value(const QString& key) {
+    return this->getConfig(key, DEFAULT_LOG_CONFIG.value(key));
+}
+
+void Logger::compile_config() {
+    std::shared_ptr<CompiledLogConfig> snapshot =
+        std::make_shared<CompiledLogConfig>();
+    CompiledLogConfig& compiled = *snapshot;
+    compiled.colored_display = this->config_value("colored_display").toBool();
+    compiled.display_time = this->config_value("display_time").toBool();
+    compiled.file_log = this->config_value("file_log").toBool();
+    compiled.file_log_level = this->config_value("file_log_level").toUInt();
+    compiled.log_print_level = this->config_value("log_print_level").toUInt();
+    compiled.console_batch_size =
+        this->config_value("console_batch_size").toInt();
+    compiled.log_flush_after_n_logs =
+        this->config_value("log_flush_after_n_logs").toInt();
+    compiled.log_stored_path = this->config_value("log_stored_path").toString();
+    compiled.log_name = this->config_value("log_name").toString();
+    compiled.log_suffix = this->config_value("log_suffix").toString();
+    compiled.log_date_format =
+        this->config_value("log_filename_date_format_str").toString();
+    compiled.log_append = this->config_value("log_append").toBool();
+    compiled.log_add_date =
+        this->config_value("log_add_date_to_suffix").toBool();
+    compiled.log_compress_rotated =
+        this->config_value("log_compress_rotated").toBool();
+    compiled.log_rotate_size =
+        this->config_value("log_rotate_size").toLongLong();
+    compiled.log_keep_files = this->config_value("log_keep_files").toInt();
+    compiled.log_json = this->config_value("log_format").toString() == "json";
+    compiled.log_index = this->config_value("log_index").toBool();
+    compiled.log_index_interval =
+        qMax(this->config_value("log_index_interval").toInt(), 1);
+    compiled.binary_log = this->config_value("binary_log").toBool();
+    compiled.binary_log_suffix =
+        this->config_value("binary_log_suffix").toString();
+    compiled.rate_limit_per_second =
+        this->config_value("rate_limit_per_second").toUInt();
+    compiled.dedup_repeated = this->config_value("dedup_repeated").toBool();
+    compiled.sample_rates[Level::DEBUG] =
+        this->config_value("sample_rate_debug").toDouble();
+    compiled.sample_rates[Level::INFO] =
+        this->config_value("sample_rate_info").toDouble();
+    compiled.flight_recorder = this->config_value("flight_recorder").toBool();
+    compiled.flight_recorder_path =
+        this->config_value("flight_recorder_path").toString();
+    if (compiled.flight_recorder_path.isEmpty()) {
+        compiled.flight_recorder_path =
+            compiled.log_stored_path + compiled.log_name + ".ring";
+    }
+    compiled.flight_recorder_level =
+        this->config_value("flight_recorder_level").toUInt();
+    compiled.flight_recorder_slots =
+        this->config_value("flight_recorder_slots").toUInt();
+    compiled.flight_recorder_slot_size =
+        this->config_value("flight_recorder_slot_size").toUInt();
+
+    bool time_quote = this->config_value("time_quote").toBool();
+    QString quote_fore = this->config_value("time_quote_fore").toString();
+    QString quote_back = this->config_value("time_quote_back").toString();
+    compiled.generation = ++config_generation;
+    compiled.time_monotonic = this->config_value("time_monotonic").toBool();
+    compiled.time_resync_interval_ms =
+        this->config_value("time_resync_interval_ms").toLongLong();
+    compiled.time_format = this->config_value("time_format").toString();
+    compiled.time_resolution_ms =
+        compiled.time_format.contains('z') ? 1 : 1000;
+    compiled.time_style = this->config_value("time_fore").toString() +
+                          this->config_value("time_back").toString();
+    compiled.time_open =
+        S(time_quote ? this->config_value("time_quote_begin").toString() : "",
+          quote_fore, quote_back);
+    compiled.time_close =
+        S(time_quote ? this->config_value("time_quote_end").toString() : "",
+          quote_fore, quote_back);
+
+    bool display_levels = this->config_value("display_levels").toBool();
+    bool display_tags = this->config_value("display_tags").toBool();
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        S level_styled;
+        if (display_levels) {
+            level_styled = this->make_level_styled((Level)level) + " ";
+        }
+        for (int tag = 0; tag < TAG_COUNT; ++tag) {
+            S tag_styled;
+            if (display_tags && tag != Tag::NO_TAG) {
+                tag_styled = this->make_tag_styled((Tag)tag) + " ";
+            }
+            compiled.prefixes[level][tag] = level_styled + tag_styled;
+        }
+    }
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        compiled.json_levels[level] = ",\"level\":";
+        json_put_text(compiled.json_levels[level],
+                      LEVELS_MAP.value((Level)level));
+    }
+    for (int tag = 1; tag < TAG_COUNT; ++tag) {
+        compiled.json_tags[tag] = ",\"tag\":";
+        json_put_text(compiled.json_tags[tag], TAGS_MAP.value((Tag)tag));
+    }
+
+    std::atomic_store(&this->compiled,
+                      std::shared_ptr<const CompiledLogConfig>(snapshot));
+    this->update_enabled_level();
+}
+
+void Logger::add_log_to_buffer(const CompiledLogConfig& compiled, Level level,
+                               const QString& log_content,
+                               const QByteArray& json, qint64 msecs) {
+    if (compiled.file_log && level >= compiled.file_log_level) {
+        StagedLog log;
+        log.msecs = msecs;
+        log.sequence = log_sequence.fetch_add(1, std::memory_order_relaxed);
+        log.level = level;
+        StagingBuffer& buffer = this->staging_buffer();
+        {
+            std::lock_guard<std::mutex> guard(buffer.lock);
+            QByteArray& text = buffer.text;
+            log.offset = text.size();
+            if (json.isEmpty()) {
+                int capacity = log_content.size() * 3;
+                text.resize(log.offset + capacity);
+                text.resize(log.offset + encode_utf8(log_content,
+                                                     text.data() + log.offset,
+                                                     capacity));
+            } else {
+                text.append(json);
+            }
+            log.size = text.size() - log.offset;
+            buffer.logs.push_back(log);
+        }
+        this->staged_count.fetch_add(1);
+        this->buffer_flush_check(compiled);
+    }
+}
+
+void Logger::buffer_flush_check(const CompiledLogConfig& compiled) {
+    // records staged while this thread holds the flush lock wait for the
+    // next flush instead of re-entering it.
+    if (flushing_logger == this) return;
+    if (this->staged_count.load() > compiled.log_flush_after_n_logs) {
+        this->flush_staged();
+    }
+}
+
+StagingBuffer& Logger::staging_buffer() {
+    for (StagingSlot& slot : staging_slots) {
+        if (slot.logger_id == this->instance_id) return *slot.buffer;
+    }
+    std::shared_ptr<StagingBuffer> buffer = std::make_shared<StagingBuffer>();
+    {
+        std::lock_guard<std::mutex> guard(this->staging_lock);
+        this->staging_buffers.push_back(buffer);
+    }
+    if (staging_slots.size() >= STAGING_SLOTS_SIZE) {
+        staging_slots.erase(staging_slots.begin());
+    }
+    staging_slots.push_back({this->instance_id, buffer});
+    return *buffer;
+}
+
+qint32 Logger::collect_staged(QList<StagedLog>& logs, QList<QByteArray>& arenas,
+                              QByteArray& binary) {
+    qint32 collected = 0;
+    std::lock_guard<std::mutex> guard(this->staging_lock);
+    for (size_t i = 0; i < this->staging_buffers.size();) {
+        std::shared_ptr<StagingBuffer>& buffer = this->staging_buffers[i];
+        {
+            std::lock_guard<std::mutex> buffer_guard(buffer->lock);
+            collected += buffer->logs.size() + buffer->binary_count;
+            if (!buffer->logs.isEmpty()) {
+                for (StagedLog& log : buffer->logs) {
+                    log.arena = arenas.size();
+                }
+                logs.append(buffer->logs);
+                buffer->logs.clear();
+                arenas.push_back(buffer->text);
+                buffer->text = QByteArray();
+            }
+            binary.append(buffer->binary);
+            buffer->binary.resize(0);
+            buffer->binary_count = 0;
+        }
+        if (buffer.use_count() == 1) {
+            this->staging_buffers.erase(this->staging_buffers.begin() + i);
+        } else {
+            ++i;
+        }
+    }
+    this->staged_count.fetch_sub(collected);
+    return collected;
+}
+
+QString Logger::log_file_path(const QDate& date, const QString& suffix) {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    QString path = compiled.log_stored_path + compiled.log_name;
+    if (compiled.log_add_date) {
+        path += "_" + date.toString(compiled.log_date_format);
+    }
+    return path + "." + suffix;
+}
+
+bool Logger::open_log_file() {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    QDate today =
+        compiled.log_add_date ? QDate::currentDate() : QDate();
+    bool stale = this->log_io_stale.exchange(false);
+    if (this->log_io.isOpen() && !stale && today == this->log_io_date) {
+        return true;
+    }
+
+    bool first_open = this->log_io.fileName().isEmpty();
+    bool rolled_over = this->log_io.isOpen() && !stale;
+    QString previous = this->log_io.fileName();
+    this->close_index_file();
+    this->log_io.close();
+    this->log_io.setFileName(
+        this->log_file_path(today, compiled.log_suffix));
+    this->log_io_date = today;
+    if (rolled_over) {
+        this->schedule_rotation_job(previous);
+    }
+    bool truncate = first_open && !compiled.log_append;
+    if (truncate) {
+        QFile::remove(this->log_io.fileName() + LOG_INDEX_SUFFIX);
+    }
+    bool opened =
+        truncate
+            ? this->log_io.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            : this->log_io.open(QIODevice::Append);
+    this->log_io_size = opened ? this->log_io.size() : 0;
+    return opened;
+}
+
+bool Logger::open_binary_file() {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    QDate today =
+        compiled.log_add_date ? QDate::currentDate() : QDate();
+    bool stale = this->binary_io_stale.exchange(false);
+    if (this->binary_io.isOpen() && !stale && today == this->binary_io_date) {
+        return true;
+    }
+
+    this->binary_io.close();
+    this->binary_io.setFileName(
+        this->log_file_path(today, compiled.binary_log_suffix));
+    this->binary_io_date = today;
+    if (!this->binary_io.open(QIODevice::Append)) return false;
+
+    QByteArray header;
+    if (this->binary_io.size() == 0) {
+        header.append(BINARY_LOG_MAGIC);
+    }
+    std::lock_guard<std::mutex> guard(format_registry_lock);
+    for (int i = 0; i < format_registry.size(); ++i) {
+        binary_put_format(header, i, format_registry[i]);
+        this->binary_defined.insert(i);
+    }
+    this->binary_io.write(header);
+    return true;
+}
+
+QByteArray& Logger::binary_record_begin(const CompiledLogConfig& compiled,
+                                        quint32 format_id, Level level,
+                                        Tag tag, quint16 argc) {
+    QByteArray& record = binary_scratch;
+    record.resize(0);
+    record.append((char)BinaryRecordType::LOG_RECORD);
+    binary_put_le(record, format_id, 4);
+    binary_put_le(record, (quint64)this->current_msecs(compiled), 8);
+    record.append((char)level);
+    record.append((char)tag);
+    binary_put_le(record, argc, 2);
+    return record;
+}
+
+void Logger::binary_record_end(const CompiledLogConfig& compiled) {
+    StagingBuffer& buffer = this->staging_buffer();
+    {
+        std::lock_guard<std::mutex> guard(buffer.lock);
+        buffer.binary.append(binary_scratch);
+        buffer.binary_count += 1;
+    }
+    this->staged_count.fetch_add(1);
+    this->buffer_flush_check(compiled);
+}
+
+void Logger::rotate_log_file() {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    QString path = this->log_io.fileName();
+    QString stem =
+        path.left(path.size() - compiled.log_suffix.size() - 1);
+    QString rotated;
+    for (quint32 index = 1;; ++index) {
+        rotated = QString("%1.%2.%3")
+                      .arg(stem)
+                      .arg(index)
+                      .arg(compiled.log_suffix);
+        if (!QFile::exists(rotated) && !QFile::exists(rotated + ".gz")) break;
+    }
+    this->close_index_file();
+    this->log_io.close();
+    if (QFile::rename(path, rotated)) {
+        QFile::rename(path + LOG_INDEX_SUFFIX, rotated + LOG_INDEX_SUFFIX);
+        this->schedule_rotation_job(rotated);
+    }
+    if (this->log_io.open(QIODevice::Append)) {
+        this->log_io_size = this->log_io.size();
+    }
+}
+
+void Logger::schedule_rotation_job(const QString& rotated_path) {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    if (!compiled.log_compress_rotated && compiled.log_keep_files <= 0) return;
+
+    RotationJob job;
+    job.rotated_path = rotated_path;
+    job.current_path = this->log_io.fileName();
+    job.stored_path = compiled.log_stored_path;
+    job.name = compiled.log_name;
+    job.suffix = compiled.log_suffix;
+    job.date_format = compiled.log_add_date ? compiled.log_date_format : "";
+    job.keep_files = compiled.log_keep_files;
+    job.compress = compiled.log_compress_rotated;
+
+    std::lock_guard<std::mutex> guard(this->rotation_lock);
+    this->rotation_jobs.push_back(job);
+    if (!this->rotation_worker.joinable()) {
+        this->rotation_stopping = false;
+        this->rotation_worker =
+            std::thread(&Logger::rotation_worker_loop, this);
+    }
+    this->rotation_cv.notify_one();
+}
+
+void Logger::stop_rotation_worker() {
+    {
+        std::lock_guard<std::mutex> guard(this->rotation_lock);
+        this->rotation_stopping = true;
+        this->rotation_cv.notify_one();
+    }
+    if (this->rotation_worker.joinable()) {
+        this->rotation_worker.join();
+    }
+}
+
+void Logger::rotation_worker_loop() {
+    std::unique_lock<std::mutex> guard(this->rotation_lock);
+    forever {
+        this->rotation_cv.wait(guard, [this] {
+            return this->rotation_stopping || !this->rotation_jobs.isEmpty();
+        });
+        if (this->rotation_jobs.isEmpty()) break;
+        RotationJob job = this->rotation_jobs.takeFirst();
+        guard.unlock();
+        if (job.compress) {
+            compress_log_file(job.rotated_path);
+        }
+        prune_log_files(job);
+        guard.lock();
+    }
+}
+
+void Logger::open_flight_recorder() {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    FlightRecorder* current = this->flight_recorder.load();
+    if (!compiled.flight_recorder) {
+        this->flight_recorder.store(nullptr);
+        return;
+    }
+    if (current != nullptr &&
+        current->path() == compiled.flight_recorder_path) {
+        return;
+    }
+    // retired recorders stay mapped until the logger is destroyed because
+    // other threads may still be writing into them.
+    std::unique_ptr<FlightRecorder> recorder(
+        new FlightRecorder(compiled.flight_recorder_path,
+                           compiled.flight_recorder_slots,
+                           compiled.flight_recorder_slot_size));
+    if (!recorder->isOpen()) {
+        this->flight_recorder.store(nullptr);
+        return;
+    }
+    this->flight_recorder.store(recorder.get());
+    this->flight_recorders.push_back(std::move(recorder));
+}
+
+void Logger::update_enabled_level() {
+    std::shared_ptr<const CompiledLogConfig> snapshot = this->snapshot();
+    const CompiledLogConfig& compiled = *snapshot;
+    quint32 enabled_level =
+        qMin(compiled.log_print_level, this->sinks_level.load());
+    if (compiled.file_log || compiled.binary_log) {
+        enabled_level = qMin(enabled_level, compiled.file_log_level);
+    }
+    if (compiled.flight_recorder) {
+        enabled_level = qMin(enabled_level, compiled.flight_recorder_level);
+    }
+    this->enabled_level.store(enabled_level, std::memory_order_relaxed);
+}
+
+void Logger::addSink(std::shared_ptr<LogSink> sink) {
+    if (sink == nullptr) return;
+    std::lock_guard<std::mutex> guard(this->sinks_lock);
+    std::shared_ptr<std::vector<std::shared_ptr<LogSink>>> sinks(
+        new std::vector<std::shared_ptr<LogSink>>());
+    std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>> current =
+        std::atomic_load(&this->sinks);
+    if (current != nullptr) *sinks = *current;
+    sinks->push_back(sink);
+    sink->start();
+    this->sinks_level.store(
+        qMin(this->sinks_level.load(), (quint32)sink->level()));
+    std::atomic_store(
+        &this->sinks,
+        std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>>(sinks));
+    this->update_enabled_level();
+}
+
+void Logger::removeSink(std::shared_ptr<LogSink> sink) {
+    std::lock_guard<std::mutex> guard(this->sinks_lock);
+    std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>> current =
+        std::atomic_load(&this->sinks);
+    if (current == nullptr) return;
+    std::shared_ptr<std::vector<std::shared_ptr<LogSink>>> sinks(
+        new std::vector<std::shared_ptr<LogSink>>());
+    quint32 sinks_level = LEVEL_COUNT;
+    for (const std::shared_ptr<LogSink>& item : *current) {
+        if (item != sink) {
+            sinks->push_back(item);
+            sinks_level = qMin(sinks_level, (quint32)item->level());
+        }
+    }
+    this->sinks_level.store(sinks_level);
+    std::atomic_store(
+        &this->sinks,
+        std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>>(sinks));
+    this->update_enabled_level();
+    if (sink != nullptr) {
+        sink->stop();
+    }
 }
 
-void Logger::add_log_to_buffer(Level level, QString log_content) {
-    if (this->getConfig("file_log").toBool() &&
-        level >= this->getConfig("file_log_level").toUInt()) {
-        this->log_buffer.push_back(log_content);
-        this->buffer_flush_check();
+void Logger::clearSinks() {
+    std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>> current;
+    {
+        std::lock_guard<std::mutex> guard(this->sinks_lock);
+        current = std::atomic_load(&this->sinks);
+        this->sinks_level.store(LEVEL_COUNT);
+        std::atomic_store(
+            &this->sinks,
+            std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>>());
+        this->update_enabled_level();
+    }
+    if (current == nullptr) return;
+    for (const std::shared_ptr<LogSink>& sink : *current) {
+        sink->stop();
+    }
+}
+
+void Logger::dispatch_sinks(const S& log_content, Level level,
+                            qint64 msecs) {
+    std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>> sinks =
+        std::atomic_load(&this->sinks);
+    if (sinks == nullptr) return;
+    SinkRecord record;
+    record.msecs = msecs;
+    record.level = level;
+    record.content = log_content.rawStr;
+    record.styled = log_content.styStr;
+    for (const std::shared_ptr<LogSink>& sink : *sinks) {
+        if (sink->accepts(level)) {
+            SinkRecord copy = record;
+            sink->push(copy);
+        }
     }
 }
 
-void Logger::buffer_flush_check() {
-    if (this->log_buffer.size() >
-        this->getConfig("log_flush_after_n_logs").toInt()) {
-        this->flushNow();
+void Logger::write_log(const CompiledLogConfig& compiled, const S& log_content,
+                       Level level, bool ignore_buffer, const QByteArray& json,
+                       qint64 msecs) {
+    if (level >= this->sinks_level.load(std::memory_order_relaxed)) {
+        this->dispatch_sinks(log_content, level, msecs);
+    }
+    if (level >= compiled.log_print_level) {
+        const QString& line = compiled.colored_display
+                                  ? log_content.styStr
+                                  : log_content.rawStr;
+        qint32 batch_size = compiled.console_batch_size;
+        if (batch_size > 0) {
+            std::lock_guard<std::mutex> guard(this->console_lock);
+            QByteArray& batch = this->console_batch;
+            int offset = batch.size();
+            batch.resize(offset + line.size() * 3);
+            batch.resize(offset + encode_utf8(line, batch.data() + offset,
+                                              line.size() * 3));
+            if (batch.size() >= batch_size) {
+                write_fully(STDOUT_FILENO, batch.constData(), batch.size());
+                batch.resize(0);
+            }
+        } else {
+            std::string bytes = line.toStdString();
+            std::lock_guard<std::mutex> guard(this->console_lock);
+            std::cout << bytes;
+        }
+    }
+    if (!ignore_buffer) {
+        this->add_log_to_buffer(compiled, level, log_content.rawStr, json,
+                                msecs);
+    }
+}
+
+void Logger::enqueue_log(LogRecord& record) {
+    switch (this->async_policy.load(std::memory_order_relaxed)) {
+        case OverflowPolicy::DROP_NEWEST:
+            if (!this->async_queue->tryPush(record)) {
+                this->async_dropped.fetch_add(1);
+                return;
+            }
+            break;
+        case OverflowPolicy::DROP_OLDEST:
+            while (!this->async_queue->tryPush(record)) {
+                LogRecord stale;
+                if (this->async_queue->tryPop(stale)) {
+                    this->async_dropped.fetch_add(1);
+                    this->async_done.fetch_add(1);
+                    this->async_progress();
+                }
+            }
+            break;
+        case OverflowPolicy::BLOCK:
+        default:
+            if (!this->async_queue->tryPush(record)) {
+                std::unique_lock<std::mutex> guard(this->async_progress_lock);
+                this->async_waiters.fetch_add(1);
+                while (!this->async_queue->tryPush(record)) {
+                    this->wake_writer();
+                    this->async_progress_cv.wait_for(
+                        guard, std::chrono::milliseconds(10));
+                }
+                this->async_waiters.fetch_sub(1);
+            }
+            break;
+    }
+    this->async_pushed.fetch_add(1);
+    this->wake_writer();
+}
+
+void Logger::async_progress() {
+    if (this->async_waiters.load() > 0) {
+        { std::lock_guard<std::mutex> guard(this->async_progress_lock); }
+        this->async_progress_cv.notify_all();
+    }
+}
+
+void Logger::wake_writer() {
+    if (this->async_idle.load()) {
+        { std::lock_guard<std::mutex> guard(this->async_idle_lock); }
+        this->async_idle_cv.notify_one();
+    }
+}
+
+void Logger::start_async() {
+    if (this->async_running.load()) return;
+    quint32 capacity = this->getConfig("async_queue_size", 8192).toUInt();
+    if (this->async_queue == nullptr ||
+        this->async_queue->capacity() < capacity) {
+        this->async_queue.reset(new BoundedQueue<LogRecord>(capacity));
+    }
+    this->async_policy.store(
+        this->getConfig("async_overflow_policy", 0).toUInt());
+    this->async_running.store(true);
+    this->async_writer = std::thread(&Logger::async_writer_loop, this);
+}
+
+void Logger::stop_async() {
+    if (!this->async_running.exchange(false)) return;
+    while (this->async_producers.load() != 0) {
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<std::mutex> guard(this->async_idle_lock);
+        this->async_idle_cv.notify_one();
+    }
+    this->async_writer.join();
+
+    LogRecord record;
+    while (this->async_queue->tryPop(record)) {
+        try {
+            this->write_log(*this->snapshot(), record.content, record.level,
+                            record.ignore_buffer, record.json, record.msecs);
+        } catch (...) {
+        }
+        this->async_done.fetch_add(1);
+    }
+    this->async_progress();
+    this->flush_console();
+    std::cout.flush();
+}
+
+void Logger::async_writer_loop() {
+    async_writer_owner = this;
+    LogRecord record;
+    forever {
+        if (this->async_queue->tryPop(record)) {
+            try {
+                this->write_log(*this->snapshot(), record.content,
+                                record.level, record.ignore_buffer,
+                                record.json, record.msecs);
+            } catch (...) {
+            }
+            this->async_done.fetch_add(1);
+            this->async_progress();
+            continue;
+        }
+        if (!this->async_running.load()) break;
+        this->flush_console();
+        std::cout.flush();
+        std::unique_lock<std::mutex> guard(this->async_idle_lock);
+        this->async_idle.store(true);
+        if (this->async_queue->empty() && this->async_running.load()) {
+            this->async_idle_cv.wait_for(guard, std::chrono::milliseconds(50));
+        }
+        this->async_idle.store(false);
+    }
+}
+
+static_assert(sizeof(LogIndexEntry) == 56, "log index entry is not packed");
+static_assert(sizeof(FlightRecorderHeader) <= FLIGHT_RECORDER_HEADER_SIZE,
+              "flight recorder header does not fit");
+static_assert(sizeof(FlightRecorderSlot) <= FLIGHT_RECORDER_SLOT_HEADER_SIZE,
+              "flight recorder slot header does not fit");
+
+FlightRecorder::FlightRecorder(QString path, quint32 slot_count,
+                               quint32 slot_size)
+    : file(path),
+      slot_count(qMax(slot_count, 1u)),
+      slot_size(qMax(slot_size, FLIGHT_RECORDER_SLOT_HEADER_SIZE + 16)) {
+    this->slot_size = (this->slot_size + 7) & ~7u;
+    qint64 size = FLIGHT_RECORDER_HEADER_SIZE +
+                  (qint64)this->slot_count * this->slot_size;
+    if (!this->file.open(QIODevice::ReadWrite)) return;
+    bool fresh = this->file.size() != size;
+    if (fresh && !this->file.resize(size)) return;
+    this->memory = this->file.map(0, size);
+    if (this->memory == nullptr) return;
+
+    FlightRecorderHeader* header = (FlightRecorderHeader*)this->memory;
+    if (fresh ||
+        memcmp(header->magic, FLIGHT_RECORDER_MAGIC.constData(), 8) != 0 ||
+        header->slot_count != this->slot_count ||
+        header->slot_size != this->slot_size) {
+        memset(this->memory, 0, size);
+        memcpy(header->magic, FLIGHT_RECORDER_MAGIC.constData(), 8);
+        header->slot_count = this->slot_count;
+        header->slot_size = this->slot_size;
+        header->write_index.store(0);
+    }
+}
+
+FlightRecorder::~FlightRecorder() {
+    if (this->memory != nullptr) {
+        this->file.unmap(this->memory);
+    }
+    this->file.close();
+}
+
+void FlightRecorder::record(qint64 msecs, Level level, Tag tag,
+                            const QString& content) {
+    FlightRecorderHeader* header = (FlightRecorderHeader*)this->memory;
+    quint64 index = header->write_index.fetch_add(1, std::memory_order_relaxed);
+    uchar* base = this->memory + FLIGHT_RECORDER_HEADER_SIZE +
+                  (index % this->slot_count) * this->slot_size;
+    FlightRecorderSlot* slot = (FlightRecorderSlot*)base;
+    slot->sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->msecs = msecs;
+    slot->level = level;
+    slot->tag = tag;
+    slot->size = encode_utf8(
+        content, (char*)base + FLIGHT_RECORDER_SLOT_HEADER_SIZE,
+        this->slot_size - FLIGHT_RECORDER_SLOT_HEADER_SIZE);
+    slot->sequence.store(index + 1, std::memory_order_release);
+}
+
+LogSink::LogSink(Level level, quint32 batch_size, quint32 flush_interval_ms,
+                 quint32 queue_size)
+    : sink_level(level),
+      batch_size(qMax(batch_size, 1u)),
+      flush_interval_ms(flush_interval_ms),
+      queue(queue_size) {}
+
+LogSink::~LogSink() {
+    if (this->worker.joinable()) {
+        this->stopping.store(true);
+        this->worker_cv.notify_one();
+        this->worker.join();
+    }
+}
+
+void LogSink::start() {
+    if (this->worker.joinable()) return;
+    this->stopping.store(false);
+    this->worker = std::thread(&LogSink::worker_loop, this);
+}
+
+void LogSink::stop() {
+    if (!this->worker.joinable()) return;
+    {
+        std::lock_guard<std::mutex> guard(this->worker_lock);
+        this->stopping.store(true);
+    }
+    this->worker_cv.notify_one();
+    this->worker.join();
+}
+
+void LogSink::push(SinkRecord& record) {
+    if (!this->queue.tryPush(record)) {
+        this->dropped.fetch_add(1);
+        return;
+    }
+    if (this->pending.fetch_add(1) + 1 == this->batch_size) {
+        this->worker_cv.notify_one();
+    }
+}
+
+void LogSink::write_batch(QList<SinkRecord>& batch, bool& opened) {
+    if (!opened) {
+        opened = this->open();
+    }
+    if (!opened || !this->write(batch)) {
+        this->failed.fetch_add(batch.size());
+        if (opened) {
+            this->close();
+            opened = false;
+        }
+    }
+    batch.clear();
+}
+
+void LogSink::worker_loop() {
+    bool opened = false;
+    QList<SinkRecord> batch;
+    SinkRecord record;
+    forever {
+        {
+            std::unique_lock<std::mutex> guard(this->worker_lock);
+            this->worker_cv.wait_for(
+                guard, std::chrono::milliseconds(this->flush_interval_ms),
+                [this] {
+                    return this->stopping.load() ||
+                           this->pending.load() >= this->batch_size;
+                });
+        }
+        bool stopping = this->stopping.load();
+        while (this->queue.tryPop(record)) {
+            this->pending.fetch_sub(1);
+            batch.push_back(record);
+            if ((quint32)batch.size() >= this->batch_size) {
+                this->write_batch(batch, opened);
+            }
+        }
+        if (!batch.isEmpty()) {
+            this->write_batch(batch, opened);
+        }
+        if (stopping) break;
+    }
+    if (opened) {
+        this->close();
+    }
+}
+
+ConsoleSink::ConsoleSink(FILE* stream, bool colored, Level level,
+                         quint32 batch_size, quint32 flush_interval_ms)
+    : LogSink(level, batch_size, flush_interval_ms),
+      stream(stream),
+      colored(colored) {}
+
+ConsoleSink::~ConsoleSink() { this->stop(); }
+
+bool ConsoleSink::write(const QList<SinkRecord>& batch) {
+    QByteArray out;
+    for (const SinkRecord& record : batch) {
+        out.append((this->colored ? record.styled : record.content).toUtf8());
+    }
+    bool written = fwrite(out.constData(), 1, out.size(), this->stream) ==
+                   (size_t)out.size();
+    fflush(this->stream);
+    return written;
+}
+
+FileSink::FileSink(QString path, Level level, quint32 batch_size,
+                   quint32 flush_interval_ms)
+    : LogSink(level, batch_size, flush_interval_ms), file(path) {}
+
+FileSink::~FileSink() { this->stop(); }
+
+bool FileSink::open() { return this->file.open(QIODevice::Append); }
+
+bool FileSink::write(const QList<SinkRecord>& batch) {
+    QByteArray out;
+    for (const SinkRecord& record : batch) {
+        out.append(record.content.toUtf8());
     }
+    return this->file.write(out) == out.size() && this->file.flush();
 }
 
-void Logger::drop_logs() { this->log_buffer.clear(); }
+void FileSink::close() { this->file.close(); }
 
 }  // namespace JLogs
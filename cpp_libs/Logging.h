@@ -16,7 +16,18 @@
 #include <QObject>
 #include <QVariant>
 #include <QtCore>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 namespace JLogs {
 
@@ -85,6 +96,8 @@ namespace JLogs {
     (ANSI_ESCAPE "48" ANSI_SEP "2" ANSI_SEP r ANSI_SEP g ANSI_SEP b ANSI_END)
 #endif
 
+class SB;
+
 struct S {
     QString rawStr, styStr;
 
@@ -93,6 +106,7 @@ struct S {
         this->rawStr = rvalue.rawStr;
         this->styStr = rvalue.styStr;
     }
+    S(const SB &rvalue);
     template <typename T>
     S(const T &content) {
         this->rawStr = this->styStr = QVariant(content).toString();
@@ -100,7 +114,7 @@ struct S {
     template <typename T, typename... Styles>
     S(const T &content, const Styles &...styles) {
         this->rawStr = QVariant(content).toString();
-        for (const QString &style : {styles...}) {
+        for (const auto &style : {styles...}) {
             this->styStr += style;
         }
         this->styStr += QVariant(content).toString() + CLEAR;
@@ -143,6 +157,103 @@ struct S {
 
 typedef S S;
 
+class SB {
+   public:
+    SB() {}
+    SB(const SB &rvalue);
+    SB(SB &&rvalue) : storage(rvalue.storage) { rvalue.storage = nullptr; }
+    template <typename T, typename... Styles>
+    explicit SB(const T &content, const Styles &...styles) {
+        this->styled(content, styles...);
+    }
+    ~SB();
+
+    SB &operator=(const SB &rvalue);
+    SB &operator=(SB &&rvalue);
+
+    template <typename T>
+    SB &operator<<(const T &rvalue) {
+        this->append(rvalue);
+        return *this;
+    }
+    template <typename T>
+    SB operator+(const T &rvalue) const & {
+        SB new_styled(*this);
+        new_styled.append(rvalue);
+        return new_styled;
+    }
+    template <typename T>
+    SB &&operator+(const T &rvalue) && {
+        this->append(rvalue);
+        return std::move(*this);
+    }
+
+    template <typename T, typename... Styles>
+    SB &styled(const T &content, const Styles &...styles) {
+        if (sizeof...(styles) == 0) {
+            this->append(content);
+            return *this;
+        }
+        int span = this->open_span();
+        int expand[] = {0, (this->add_style(span, styles), 0)...};
+        (void)expand;
+        this->append(content);
+        this->close_span(span);
+        return *this;
+    }
+
+    bool isEmpty() const;
+    void clear();
+    const QByteArray &raw() const;
+    void appendRaw(QByteArray &out) const;
+    void appendStyled(QByteArray &out) const;
+    QByteArray styledBytes() const;
+
+    operator QString() const { return QString::fromUtf8(this->raw()); }
+
+    struct Storage;
+
+   private:
+    Storage &data();
+
+    int open_span();
+    void add_style(int span, const char *style);
+    void add_style(int span, const QString &style);
+    void close_span(int span);
+
+    void append(const SB &rvalue);
+    void append(const char *rvalue);
+    void append(const QString &rvalue);
+    void append(const QByteArray &rvalue);
+    void append(const std::string &rvalue);
+    void append(char rvalue);
+    void append(bool rvalue);
+    void append_int(qint64 rvalue);
+    void append_uint(quint64 rvalue);
+    void append_float(double rvalue, int precision);
+
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                            std::is_signed<T>::value>::type
+    append(T rvalue) {
+        this->append_int(rvalue);
+    }
+    template <typename T>
+    typename std::enable_if<std::is_integral<T>::value &&
+                            std::is_unsigned<T>::value &&
+                            !std::is_same<T, bool>::value>::type
+    append(T rvalue) {
+        this->append_uint(rvalue);
+    }
+    template <typename T>
+    typename std::enable_if<std::is_floating_point<T>::value>::type append(
+        T rvalue) {
+        this->append_float(rvalue, std::is_same<T, float>::value ? 7 : 15);
+    }
+
+    Storage *storage = nullptr;
+};
+
 enum Level { DEBUG, INFO, WARN, ERR, CRIT };
 
 enum Tag {
@@ -156,11 +267,30 @@ enum Tag {
     DANGER
 };
 
+enum OverflowPolicy { BLOCK, DROP_NEWEST, DROP_OLDEST };
+
+enum BinaryRecordType : quint8 { FORMAT_RECORD = 'F', LOG_RECORD = 'R' };
+
+enum BinaryArgType : quint8 {
+    ARG_INT = 'i',
+    ARG_UINT = 'u',
+    ARG_DOUBLE = 'd',
+    ARG_BOOL = 'b',
+    ARG_STRING = 's'
+};
+
+const QByteArray BINARY_LOG_MAGIC("JLOG\x01", 5);
+
+const int LEVEL_COUNT = Level::CRIT + 1;
+const int TAG_COUNT = Tag::DANGER + 1;
+
 const QHash<QString, QVariant> DEFAULT_LOG_CONFIG{
     {"colored_display", true},
 
     {"display_time", true},
     {"time_format", "yyyy-MM-dd hh:mm:ss"},
+    {"time_monotonic", false},
+    {"time_resync_interval_ms", 1000},
     {"time_fore", BRIGHT_BLACK},
     {"time_back", DEFAULT_BG},
 
@@ -219,7 +349,30 @@ const QHash<QString, QVariant> DEFAULT_LOG_CONFIG{
     {"log_add_date_to_suffix", true},
     {"log_filename_date_format_str", "yyyy_MM_dd"},
     {"log_suffix", "txt"},
-    {"log_flush_after_n_logs", 0}};
+    {"log_format", "text"},
+    {"log_index", false},
+    {"log_index_interval", 1024},
+    {"console_batch_size", 0},
+    {"log_flush_after_n_logs", 0},
+    {"log_rotate_size", 0},
+    {"log_keep_files", 0},
+    {"log_compress_rotated", false},
+    {"rate_limit_per_second", 0},
+    {"dedup_repeated", false},
+    {"sample_rate_debug", 1.0},
+    {"sample_rate_info", 1.0},
+
+    {"binary_log", false},
+    {"flight_recorder", false},
+    {"flight_recorder_path", ""},
+    {"flight_recorder_level", Level::INFO},
+    {"flight_recorder_slots", 4096},
+    {"flight_recorder_slot_size", 256},
+    {"binary_log_suffix", "jlog"},
+
+    {"async_mode", false},
+    {"async_queue_size", 8192},
+    {"async_overflow_policy", OverflowPolicy::BLOCK}};
 
 const QHash<Level, QString> LEVELS_MAP{{Level::DEBUG, "debug"},
                                        {Level::INFO, "info"},
@@ -233,6 +386,458 @@ const QHash<Tag, QString> TAGS_MAP{
     {Tag::CANCELED, "canceled"},   {Tag::QUESTION, "question"},
     {Tag::DANGER, "danger"}};
 
+template <typename T>
+class BoundedQueue {
+   public:
+    BoundedQueue(quint32 capacity) {
+        quint32 size = 2;
+        while (size < capacity) size <<= 1;
+        this->cells.reset(new Cell[size]);
+        this->mask = size - 1;
+        for (quint32 i = 0; i < size; ++i) {
+            this->cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    quint32 capacity() const { return this->mask + 1; }
+
+    bool empty() const {
+        return this->dequeue_pos.load(std::memory_order_acquire) ==
+               this->enqueue_pos.load(std::memory_order_acquire);
+    }
+
+    bool tryPush(T &item) {
+        Cell *cell;
+        size_t pos = this->enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &this->cells[pos & this->mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (this->enqueue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = this->enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T &item) {
+        Cell *cell;
+        size_t pos = this->dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = &this->cells[pos & this->mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (this->dequeue_pos.compare_exchange_weak(
+                        pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = this->dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        item = std::move(cell->data);
+        cell->data = T();
+        cell->sequence.store(pos + this->mask + 1, std::memory_order_release);
+        return true;
+    }
+
+   private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> enqueue_pos{0};
+    alignas(64) std::atomic<size_t> dequeue_pos{0};
+};
+
+struct CompiledLogConfig {
+    bool colored_display = true;
+    bool display_time = true;
+    bool file_log = true;
+    quint32 file_log_level = Level::INFO;
+    quint32 log_print_level = Level::INFO;
+    qint32 console_batch_size = 0;
+    qint32 log_flush_after_n_logs = 0;
+    quint64 generation = 0;
+
+    bool time_monotonic = false;
+    qint64 time_resync_interval_ms = 1000;
+    qint64 time_resolution_ms = 1000;
+
+    QString log_stored_path, log_name, log_suffix, log_date_format;
+    bool log_append = true;
+    bool log_add_date = true;
+    bool log_compress_rotated = false;
+    bool log_json = false;
+    bool log_index = false;
+    qint32 log_index_interval = 1024;
+    qint64 log_rotate_size = 0;
+    qint32 log_keep_files = 0;
+
+    bool binary_log = false;
+    QString binary_log_suffix;
+
+    quint32 rate_limit_per_second = 0;
+    bool dedup_repeated = false;
+    double sample_rates[LEVEL_COUNT] = {1.0, 1.0, 1.0, 1.0, 1.0};
+
+    bool flight_recorder = false;
+    QString flight_recorder_path;
+    quint32 flight_recorder_level = Level::INFO;
+    quint32 flight_recorder_slots = 4096;
+    quint32 flight_recorder_slot_size = 256;
+
+    QString time_format;
+    QString time_style;
+    S time_open, time_close;
+    S prefixes[LEVEL_COUNT][TAG_COUNT];
+    QByteArray json_levels[LEVEL_COUNT], json_tags[TAG_COUNT];
+};
+
+struct LogRecord {
+    S content;
+    QByteArray json;
+    Level level = Level::INFO;
+    bool ignore_buffer = false;
+    qint64 msecs = 0;
+};
+
+inline void binary_put_le(QByteArray &out, quint64 value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out.append((char)((value >> (8 * i)) & 0xFF));
+    }
+}
+
+inline void binary_put_bytes(QByteArray &out, const char *data, int size) {
+    out.append((char)BinaryArgType::ARG_STRING);
+    binary_put_le(out, (quint32)size, 4);
+    out.append(data, size);
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value &&
+                        std::is_signed<T>::value>::type
+binary_put(QByteArray &out, T value) {
+    out.append((char)BinaryArgType::ARG_INT);
+    binary_put_le(out, (quint64)(qint64)value, 8);
+}
+
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value &&
+                        std::is_unsigned<T>::value &&
+                        !std::is_same<T, bool>::value>::type
+binary_put(QByteArray &out, T value) {
+    out.append((char)BinaryArgType::ARG_UINT);
+    binary_put_le(out, (quint64)value, 8);
+}
+
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value>::type binary_put(
+    QByteArray &out, T value) {
+    double number = value;
+    quint64 bits;
+    memcpy(&bits, &number, sizeof(bits));
+    out.append((char)BinaryArgType::ARG_DOUBLE);
+    binary_put_le(out, bits, 8);
+}
+
+inline void binary_put(QByteArray &out, bool value) {
+    out.append((char)BinaryArgType::ARG_BOOL);
+    out.append((char)(value ? 1 : 0));
+}
+
+inline void binary_put(QByteArray &out, const char *value) {
+    binary_put_bytes(out, value, (int)strlen(value));
+}
+
+inline void binary_put(QByteArray &out, const QByteArray &value) {
+    binary_put_bytes(out, value.constData(), value.size());
+}
+
+inline void binary_put(QByteArray &out, const std::string &value) {
+    binary_put_bytes(out, value.data(), (int)value.size());
+}
+
+inline void binary_put(QByteArray &out, const QString &value) {
+    binary_put(out, value.toUtf8());
+}
+
+struct StagedLog {
+    qint64 msecs = 0;
+    quint64 sequence = 0;
+    qint32 arena = 0;
+    qint32 offset = 0;
+    qint32 size = 0;
+    Level level = Level::INFO;
+};
+
+const QByteArray LOG_INDEX_MAGIC("JLIDX001", 8);
+const QString LOG_INDEX_SUFFIX(".idx");
+
+struct LogIndexEntry {
+    quint64 offset = 0;
+    quint32 size = 0;
+    quint32 records = 0;
+    qint64 first_msecs = 0;
+    qint64 last_msecs = 0;
+    quint32 levels[LEVEL_COUNT] = {0};
+    quint32 reserved = 0;
+};
+
+struct StagingBuffer {
+    std::mutex lock;
+    QByteArray text;
+    QList<StagedLog> logs;
+    QByteArray binary;
+    qint32 binary_count = 0;
+};
+
+const QByteArray FLIGHT_RECORDER_MAGIC("JLRING01", 8);
+const quint32 FLIGHT_RECORDER_HEADER_SIZE = 64;
+const quint32 FLIGHT_RECORDER_SLOT_HEADER_SIZE = 24;
+
+struct FlightRecorderHeader {
+    char magic[8];
+    quint32 slot_count;
+    quint32 slot_size;
+    std::atomic<quint64> write_index;
+};
+
+struct FlightRecorderSlot {
+    std::atomic<quint64> sequence;
+    qint64 msecs;
+    quint8 level;
+    quint8 tag;
+    quint16 size;
+};
+
+class FlightRecorder {
+   public:
+    FlightRecorder(QString path, quint32 slot_count, quint32 slot_size);
+    ~FlightRecorder();
+
+    bool isOpen() const { return this->memory != nullptr; }
+    QString path() const { return this->file.fileName(); }
+    void record(qint64 msecs, Level level, Tag tag, const QString &content);
+
+   private:
+    QFile file;
+    uchar *memory = nullptr;
+    quint32 slot_count = 0;
+    quint32 slot_size = 0;
+};
+
+struct LogCallSite {
+    LogCallSite(const char *file, int line) : file(file), line(line) {}
+
+    const char *file;
+    int line;
+    std::atomic<qint64> window{-1};
+    std::atomic<quint32> count{0};
+    std::atomic<quint64> suppressed{0};
+};
+
+struct LogField {
+    enum Type : quint8 { INT, UINT, DOUBLE, BOOL, TEXT, STRING };
+
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value &&
+                                          std::is_signed<T>::value,
+                                      int>::type = 0>
+    LogField(const char *key, T value) : key(key), type(INT) {
+        this->i = value;
+    }
+    template <typename T,
+              typename std::enable_if<std::is_integral<T>::value &&
+                                          std::is_unsigned<T>::value &&
+                                          !std::is_same<T, bool>::value,
+                                      int>::type = 0>
+    LogField(const char *key, T value) : key(key), type(UINT) {
+        this->u = value;
+    }
+    template <typename T,
+              typename std::enable_if<std::is_floating_point<T>::value,
+                                      int>::type = 0>
+    LogField(const char *key, T value) : key(key), type(DOUBLE) {
+        this->d = value;
+    }
+    LogField(const char *key, bool value) : key(key), type(BOOL) {
+        this->b = value;
+    }
+    LogField(const char *key, const char *value) : key(key), type(TEXT) {
+        this->text.data = value;
+        this->text.size = value == nullptr ? 0 : (int)strlen(value);
+    }
+    LogField(const char *key, const QByteArray &value) : key(key), type(TEXT) {
+        this->text.data = value.constData();
+        this->text.size = value.size();
+    }
+    LogField(const char *key, const std::string &value)
+        : key(key), type(TEXT) {
+        this->text.data = value.data();
+        this->text.size = (int)value.size();
+    }
+    LogField(const char *key, const QString &value) : key(key), type(STRING) {
+        this->string = &value;
+    }
+
+    const char *key;
+    Type type;
+    union {
+        qint64 i;
+        quint64 u;
+        double d;
+        bool b;
+        struct {
+            const char *data;
+            int size;
+        } text;
+        const QString *string;
+    };
+};
+
+struct SinkRecord {
+    qint64 msecs = 0;
+    Level level = Level::INFO;
+    QString content;
+    QString styled;
+};
+
+class LogSink {
+   public:
+    LogSink(Level level = Level::INFO, quint32 batch_size = 64,
+            quint32 flush_interval_ms = 1000, quint32 queue_size = 8192);
+    virtual ~LogSink();
+
+    Level level() const { return this->sink_level; }
+    bool accepts(Level level) const { return level >= this->sink_level; }
+    quint64 droppedRecords() const { return this->dropped.load(); }
+    quint64 failedRecords() const { return this->failed.load(); }
+
+    void start();
+    void stop();
+    void push(SinkRecord &record);
+
+   protected:
+    // called on the sink worker thread; subclasses must call stop() in their
+    // destructor so the worker never calls into a destroyed object.
+    virtual bool open() { return true; }
+    virtual bool write(const QList<SinkRecord> &batch) = 0;
+    virtual void close() {}
+
+   private:
+    void write_batch(QList<SinkRecord> &batch, bool &opened);
+    void worker_loop();
+
+    Level sink_level;
+    quint32 batch_size;
+    quint32 flush_interval_ms;
+    BoundedQueue<SinkRecord> queue;
+    std::thread worker;
+    std::atomic<bool> stopping{false};
+    std::atomic<quint32> pending{0};
+    std::atomic<quint64> dropped{0};
+    std::atomic<quint64> failed{0};
+    std::mutex worker_lock;
+    std::condition_variable worker_cv;
+};
+
+class ConsoleSink : public LogSink {
+   public:
+    ConsoleSink(FILE *stream = stderr, bool colored = true,
+                Level level = Level::INFO, quint32 batch_size = 64,
+                quint32 flush_interval_ms = 100);
+    ~ConsoleSink();
+
+   protected:
+    bool write(const QList<SinkRecord> &batch) override;
+
+   private:
+    FILE *stream;
+    bool colored;
+};
+
+class FileSink : public LogSink {
+   public:
+    FileSink(QString path, Level level = Level::INFO, quint32 batch_size = 256,
+             quint32 flush_interval_ms = 1000);
+    ~FileSink();
+
+   protected:
+    bool open() override;
+    bool write(const QList<SinkRecord> &batch) override;
+    void close() override;
+
+   private:
+    QFile file;
+};
+
+struct RotationJob {
+    QString rotated_path;
+    QString current_path;
+    QString stored_path;
+    QString name;
+    QString suffix;
+    QString date_format;
+    qint32 keep_files = 0;
+    bool compress = false;
+};
+
+#ifndef JLOGS_MIN_LEVEL
+#define JLOGS_MIN_LEVEL 0
+#endif
+
+#define JLOG_BINARY(logger, level, tag, format, ...)                        \
+    do {                                                                    \
+        if ((level) >= JLOGS_MIN_LEVEL && (logger).isEnabled(level)) {      \
+            static const quint32 jlog_format_id =                           \
+                JLogs::Logger::registerFormat(format);                      \
+            (logger).binary(jlog_format_id, level, tag, ##__VA_ARGS__);     \
+        }                                                                   \
+    } while (0)
+
+// per-second limits are kept per call site, so only the JLOG* macros are
+// rate limited; Logger::log() and the level methods are never throttled.
+// dedup_repeated and the sample rates apply to every call.
+#define JLOG_RATE_LIMITED(logger, per_second, level, content, ...)          \
+    do {                                                                    \
+        if ((level) >= JLOGS_MIN_LEVEL && (logger).isEnabled(level)) {      \
+            static JLogs::LogCallSite jlog_call_site(__FILE__, __LINE__);   \
+            if ((logger).admitCallSite(jlog_call_site, per_second)) {       \
+                (logger).log(content, level, ##__VA_ARGS__);                \
+            }                                                               \
+        }                                                                   \
+    } while (0)
+
+#define JLOG(logger, level, content, ...) \
+    JLOG_RATE_LIMITED(logger, 0, level, content, ##__VA_ARGS__)
+
+#define JLOG_DEBUG(logger, content, ...) \
+    JLOG(logger, JLogs::Level::DEBUG, content, ##__VA_ARGS__)
+#define JLOG_INFO(logger, content, ...) \
+    JLOG(logger, JLogs::Level::INFO, content, ##__VA_ARGS__)
+#define JLOG_WARN(logger, content, ...) \
+    JLOG(logger, JLogs::Level::WARN, content, ##__VA_ARGS__)
+#define JLOG_ERROR(logger, content, ...) \
+    JLOG(logger, JLogs::Level::ERR, content, ##__VA_ARGS__)
+#define JLOG_CRITICAL(logger, content, ...) \
+    JLOG(logger, JLogs::Level::CRIT, content, ##__VA_ARGS__)
+
 class Logger {
    public:
     Logger(QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG);
@@ -254,27 +859,193 @@ class Logger {
                bool ignore_buffer = false);
     void critical(const S &content, Tag tag = Tag::NO_TAG,
                   bool ignore_buffer = false);
+    void log(const SB &content, Level level = Level::INFO,
+             Tag tag = Tag::NO_TAG, bool ignore_buffer = false);
+    void debug(const SB &content, Tag tag = Tag::NO_TAG,
+               bool ignore_buffer = false);
+    void info(const SB &content, Tag tag = Tag::NO_TAG,
+              bool ignore_buffer = false);
+    void warn(const SB &content, Tag tag = Tag::NO_TAG,
+              bool ignore_buffer = false);
+    void error(const SB &content, Tag tag = Tag::NO_TAG,
+               bool ignore_buffer = false);
+    void critical(const SB &content, Tag tag = Tag::NO_TAG,
+                  bool ignore_buffer = false);
+    void logFields(Level level, Tag tag, const char *message,
+                   std::initializer_list<LogField> fields);
+    void logFields(Level level, const char *message,
+                   std::initializer_list<LogField> fields);
     void flushNow();
+    void shutdown();
+    void addSink(std::shared_ptr<LogSink> sink);
+    void removeSink(std::shared_ptr<LogSink> sink);
+    void clearSinks();
+    quint64 droppedLogs() const;
+    bool admitCallSite(LogCallSite &site, quint32 per_second = 0);
+    bool isEnabled(Level level) const {
+        return (quint32)level >=
+               this->enabled_level.load(std::memory_order_relaxed);
+    }
+
+    static quint32 registerFormat(const QString &format);
+    template <typename... Args>
+    void binary(quint32 format_id, Level level, Tag tag, const Args &...args) {
+        std::shared_ptr<const CompiledLogConfig> compiled = this->snapshot();
+        if (!compiled->binary_log || level < compiled->file_log_level) {
+            return;
+        }
+        QByteArray &record = this->binary_record_begin(
+            *compiled, format_id, level, tag, sizeof...(args));
+        int expand[] = {0, (binary_put(record, args), 0)...};
+        (void)expand;
+        this->binary_record_end(*compiled);
+    }
 
    private:
     S make_level_styled(Level level);
-    S make_prefix_styled(Level level, Tag tag);
-    S make_time_styled();
+    S make_prefix_styled(const CompiledLogConfig &compiled, Level level,
+                         Tag tag, qint64 msecs);
+    S make_time_styled(const CompiledLogConfig &compiled, qint64 msecs);
     S make_tag_styled(Tag tag);
+    qint64 current_msecs(const CompiledLogConfig &compiled);
+    QVariant config_value(const QString &key);
+    void compile_config();
+    std::shared_ptr<const CompiledLogConfig> snapshot() const {
+        return std::atomic_load(&this->compiled);
+    }
+
+    void add_log_to_buffer(const CompiledLogConfig &compiled, Level level,
+                           const QString &log_content, const QByteArray &json,
+                           qint64 msecs);
+    void buffer_flush_check(const CompiledLogConfig &compiled);
+    StagingBuffer &staging_buffer();
+    qint32 collect_staged(QList<StagedLog> &logs, QList<QByteArray> &arenas,
+                          QByteArray &binary);
+    void flush_console();
+    void index_logs(const QList<StagedLog> &logs, qint64 offset,
+                    qint64 written);
+    void write_index_block();
+    void close_index_file();
 
-    void add_log_to_buffer(Level level, QString log_content);
-    void buffer_flush_check();
-    void drop_logs();
+    QString log_file_path(const QDate &date, const QString &suffix);
+    bool open_log_file();
+    bool open_binary_file();
+    QByteArray &binary_record_begin(const CompiledLogConfig &compiled,
+                                    quint32 format_id, Level level, Tag tag,
+                                    quint16 argc);
+    void binary_record_end(const CompiledLogConfig &compiled);
+    void rotate_log_file();
+    void schedule_rotation_job(const QString &rotated_path);
+    void stop_rotation_worker();
+    void rotation_worker_loop();
+
+    void write_log(const CompiledLogConfig &compiled, const S &log_content,
+                   Level level, bool ignore_buffer, const QByteArray &json,
+                   qint64 msecs);
+    void enqueue_log(LogRecord &record);
+    void wake_writer();
+    void async_progress();
+    void flush_staged();
+    void log_formatted(const CompiledLogConfig &compiled, const S &content,
+                       Level level, Tag tag, bool ignore_buffer,
+                       QByteArray json = QByteArray());
+    bool json_wanted(const CompiledLogConfig &compiled, Level level,
+                     bool ignore_buffer) const {
+        return !ignore_buffer && compiled.log_json && compiled.file_log &&
+               level >= compiled.file_log_level;
+    }
+    void json_line(const CompiledLogConfig &compiled, QByteArray &out,
+                   Level level, Tag tag, const char *message, int size,
+                   const LogField *fields, int field_count);
+    bool admit(const CompiledLogConfig &compiled, const QString &content,
+               Level level, Tag tag);
+    void report_suppressed();
+    void open_flight_recorder();
+    void dispatch_sinks(const S &log_content, Level level, qint64 msecs);
+    void update_enabled_level();
+    void start_async();
+    void stop_async();
+    void async_writer_loop();
 
    private:
     QHash<QString, QVariant> config;
-    QList<QString> log_buffer;
+    std::mutex config_lock;
+    std::mutex config_write_lock;
+    std::shared_ptr<const CompiledLogConfig> compiled;
+    std::atomic<quint32> enabled_level{Level::DEBUG};
+
+    QList<LogCallSite *> suppressed_sites;
+    std::atomic<quint64> sampled_out{0};
+    std::atomic<bool> has_suppressed{false};
+    std::atomic<qint64> last_report{0};
+    QString dedup_content;
+    Level dedup_level = Level::INFO;
+    Tag dedup_tag = Tag::NO_TAG;
+    quint64 dedup_repeats = 0;
+    std::mutex suppress_lock;
+
+    std::vector<std::unique_ptr<FlightRecorder>> flight_recorders;
+    std::atomic<FlightRecorder *> flight_recorder{nullptr};
+
+    std::shared_ptr<const std::vector<std::shared_ptr<LogSink>>> sinks;
+    std::atomic<quint32> sinks_level{LEVEL_COUNT};
+    std::mutex sinks_lock;
+    quint64 instance_id;
+    std::vector<std::shared_ptr<StagingBuffer>> staging_buffers;
+    std::mutex staging_lock;
+    std::atomic<qint32> staged_count{0};
+    std::mutex console_lock;
+    QByteArray console_batch;
+
     QFile log_io;
+    QDate log_io_date;
+    qint64 log_io_size = 0;
+    std::atomic<bool> log_io_stale{true};
+    QFile index_io;
+    LogIndexEntry index_block;
+
+    QSet<quint32> binary_defined;
+    QFile binary_io;
+    QDate binary_io_date;
+    std::atomic<bool> binary_io_stale{true};
 
     QMutex lock;
+
+    std::thread rotation_worker;
+    QList<RotationJob> rotation_jobs;
+    bool rotation_stopping = false;
+    std::mutex rotation_lock;
+    std::condition_variable rotation_cv;
+
+    std::unique_ptr<BoundedQueue<LogRecord>> async_queue;
+    std::thread async_writer;
+    std::atomic<quint32> async_policy{OverflowPolicy::BLOCK};
+    std::atomic<bool> async_running{false};
+    std::atomic<bool> async_idle{false};
+    std::atomic<quint32> async_producers{0};
+    std::atomic<quint64> async_dropped{0};
+    std::atomic<quint64> async_pushed{0};
+    std::atomic<quint64> async_done{0};
+    std::atomic<quint32> async_waiters{0};
+    std::mutex async_idle_lock;
+    std::condition_variable async_idle_cv;
+    std::mutex async_progress_lock;
+    std::condition_variable async_progress_cv;
 };
 
-static JLogs::Logger globalLogger;
+// the process-wide logger, created on first use and never destroyed so code
+// running during static destruction can still log. it is shut down at exit.
+inline Logger &getGlobalLogger() {
+    static Logger *instance = [] {
+        Logger *logger = new Logger();
+        std::atexit([] { getGlobalLogger().shutdown(); });
+        return logger;
+    }();
+    return *instance;
+}
+
+// kept so existing globalLogger.info(...) callers still build.
+inline Logger &globalLogger = getGlobalLogger();
 
 }  // namespace JLogs
 
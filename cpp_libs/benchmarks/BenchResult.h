@@ -0,0 +1,48 @@
+/*
+ * file name:       BenchResult.h
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#ifndef BENCH_RESULT_H
+#define BENCH_RESULT_H
+
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <vector>
+
+struct BenchResult {
+    QList<QPair<QString, QString>> fields;
+    bool failed = false;
+
+    void add(const QString &key, const QString &value) {
+        this->fields.push_back({key, "\"" + value + "\""});
+    }
+    void add(const QString &key, qint64 value) {
+        this->fields.push_back({key, QString::number(value)});
+    }
+    void add(const QString &key, double value) {
+        this->fields.push_back({key, QString::number(value, 'f', 1)});
+    }
+    void add(const QString &key, bool value) {
+        this->fields.push_back({key, value ? "true" : "false"});
+    }
+    QString json() const {
+        QStringList parts;
+        for (const QPair<QString, QString> &field : this->fields) {
+            parts << "\"" + field.first + "\":" + field.second;
+        }
+        return "{" + parts.join(",") + "}";
+    }
+};
+
+inline qint64 percentile(const std::vector<qint64> &sorted, double ratio) {
+    if (sorted.empty()) return 0;
+    size_t index = qMin(sorted.size() - 1, (size_t)(sorted.size() * ratio));
+    return sorted[index];
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ * file name:       LoggerBaselineBenchmark.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+// only uses the Logger API and config keys of the original release so the
+// same source builds against every revision and the numbers compare
+// directly.
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../Logging.h"
+#include "BenchResult.h"
+
+using namespace JLogs;
+
+typedef std::chrono::steady_clock Clock;
+
+struct BaselineCase {
+    QString name;
+    bool file = true;
+    bool console = false;
+    bool colored = false;
+    bool display_time = true;
+    qint32 flush_after = 0;
+};
+
+static QList<BaselineCase> make_cases() {
+    QList<BaselineCase> cases;
+    BaselineCase format_only;
+    format_only.name = "format_only";
+    format_only.file = false;
+    cases << format_only;
+
+    BaselineCase no_time = format_only;
+    no_time.name = "format_no_time";
+    no_time.display_time = false;
+    cases << no_time;
+
+    BaselineCase console;
+    console.name = "console_colored";
+    console.file = false;
+    console.console = true;
+    console.colored = true;
+    cases << console;
+
+    BaselineCase flush_each;
+    flush_each.name = "file_flush_each";
+    cases << flush_each;
+
+    BaselineCase flush_batched;
+    flush_batched.name = "file_flush_256";
+    flush_batched.flush_after = 256;
+    cases << flush_batched;
+    return cases;
+}
+
+static QHash<QString, QVariant> make_config(const BaselineCase &bench,
+                                            const QString &directory) {
+    QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+    config["colored_display"] = bench.colored;
+    config["display_time"] = bench.display_time;
+    config["log_print_level"] =
+        bench.console ? (int)Level::INFO : (int)Level::CRIT + 1;
+    config["file_log"] = bench.file;
+    config["file_log_level"] = Level::INFO;
+    config["log_stored_path"] = directory + "/";
+    config["log_name"] = "baseline_" + bench.name;
+    config["log_append"] = true;
+    config["log_add_date_to_suffix"] = false;
+    config["log_flush_after_n_logs"] = bench.flush_after;
+    // the original flushNow looks these keys up under misspelled names and
+    // throws when they are missing; later revisions ignore them.
+    config["log_styledtored_path"] = directory + "/";
+    config["log_add_date_to_styleduffix"] = false;
+    config["log_filename_date_format_styledtr"] = "yyyy_MM_dd";
+    config["log_styleduffix"] = "txt";
+    return config;
+}
+
+static BenchResult run_case(const BaselineCase &bench, qint32 iterations,
+                            const QString &directory) {
+    std::vector<qint64> samples;
+    samples.reserve(iterations);
+    qint64 elapsed_ns = 0;
+    {
+        Logger logger(make_config(bench, directory));
+        Clock::time_point begin = Clock::now();
+        for (qint32 i = 0; i < iterations; ++i) {
+            Clock::time_point start = Clock::now();
+            logger.info(S("request ") + S(i, GREEN) + " from worker " + S(3) +
+                        " served in " + S(1.25) + "ms");
+            samples.push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    Clock::now() - start)
+                    .count());
+        }
+        if (bench.file) logger.flushNow();
+        elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         Clock::now() - begin)
+                         .count();
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.add("suite", QString("baseline"));
+    result.add("case", bench.name);
+    result.add("file", bench.file);
+    result.add("console", bench.console);
+    result.add("flush_after", (qint64)bench.flush_after);
+    result.add("iterations", (qint64)iterations);
+    result.add("ops_per_sec", iterations * 1e9 / qMax(elapsed_ns, (qint64)1));
+    result.add("p50_ns", percentile(samples, 0.50));
+    result.add("p99_ns", percentile(samples, 0.99));
+    result.add("max_ns", samples.empty() ? 0 : samples.back());
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    qint32 iterations = 20000;
+    QString filter;
+    for (int i = 1; i + 1 < args.size(); i += 2) {
+        if (args[i] == "--iterations") {
+            iterations = qMax(args[i + 1].toInt(), 1);
+        } else if (args[i] == "--filter") {
+            filter = args[i + 1];
+        } else {
+            err << "usage: " << args[0]
+                << " [--iterations N] [--filter text]\n"
+                << "log lines go to stdout, redirect it to /dev/null\n";
+            return 1;
+        }
+    }
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err << "cannot create a temporary directory\n";
+        return 1;
+    }
+
+    QFile output;
+    if (!output.open(stderr, QIODevice::WriteOnly)) return 1;
+    for (const BaselineCase &bench : make_cases()) {
+        if (!filter.isEmpty() && !bench.name.contains(filter)) continue;
+        BenchResult result = run_case(bench, iterations, directory.path());
+        output.write((result.json() + "\n").toUtf8());
+        output.flush();
+    }
+    return 0;
+}
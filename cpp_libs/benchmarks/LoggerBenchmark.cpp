@@ -0,0 +1,287 @@
+/*
+ * file name:       LoggerBenchmark.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "../Logging.h"
+#include "BenchResult.h"
+
+using namespace JLogs;
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    qint32 iterations = 100000;
+    qint32 max_threads = 32;
+    QString filter;
+    QString output_path;
+    QString directory;
+};
+
+struct LogCase {
+    QString name;
+    bool builder = false;
+    bool colored = false;
+    bool console = false;
+    bool file = true;
+    qint32 flush_after = 0;
+    qint32 console_batch = 0;
+    bool async = false;
+    qint32 threads = 1;
+};
+
+static qint64 write_syscalls() {
+    QFile io("/proc/self/io");
+    if (!io.open(QIODevice::ReadOnly)) return -1;
+    for (const QByteArray &line : io.readAll().split('\n')) {
+        if (line.startsWith("syscw:")) {
+            return line.mid(6).trimmed().toLongLong();
+        }
+    }
+    return -1;
+}
+
+static QHash<QString, QVariant> make_config(const BenchOptions &options,
+                                            const LogCase &bench,
+                                            const QString &log_name) {
+    QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+    config["colored_display"] = bench.colored;
+    config["log_print_level"] = bench.console ? Level::INFO : LEVEL_COUNT;
+    config["file_log"] = bench.file;
+    config["file_log_level"] = Level::INFO;
+    config["log_stored_path"] = options.directory + "/";
+    config["log_name"] = log_name;
+    config["log_append"] = false;
+    config["log_add_date_to_suffix"] = false;
+    config["log_flush_after_n_logs"] = bench.flush_after;
+    config["console_batch_size"] = bench.console_batch;
+    config["async_mode"] = bench.async;
+    config["async_overflow_policy"] = OverflowPolicy::BLOCK;
+    return config;
+}
+
+static void log_line(Logger &logger, const LogCase &bench, qint32 thread,
+                     qint32 index) {
+    if (bench.builder) {
+        logger.info(SB("request ") << SB(index, GREEN) << " from worker "
+                                   << thread << " served in " << 1.25 << "ms");
+    } else {
+        logger.info(S("request ") + S(index, GREEN) + " from worker " +
+                    S(thread) + " served in " + S(1.25) + "ms");
+    }
+}
+
+static BenchResult run_log_case(const BenchOptions &options,
+                                const LogCase &bench) {
+    QString log_name = QString("bench_%1").arg(bench.name);
+    qint32 per_thread = qMax(options.iterations / bench.threads, 1);
+    std::vector<std::vector<qint64>> latencies(bench.threads);
+    qint64 elapsed_ns = 0;
+    qint64 syscalls = write_syscalls();
+    {
+        Logger logger(make_config(options, bench, log_name));
+        std::atomic<bool> start{false};
+        std::vector<std::thread> workers;
+        for (qint32 t = 0; t < bench.threads; ++t) {
+            workers.emplace_back([&, t]() {
+                std::vector<qint64> &samples = latencies[t];
+                samples.reserve(per_thread);
+                while (!start.load()) std::this_thread::yield();
+                for (qint32 i = 0; i < per_thread; ++i) {
+                    Clock::time_point begin = Clock::now();
+                    log_line(logger, bench, t, i);
+                    samples.push_back(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - begin)
+                            .count());
+                }
+            });
+        }
+        Clock::time_point begin = Clock::now();
+        start.store(true);
+        for (std::thread &worker : workers) worker.join();
+        logger.shutdown();
+        elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         Clock::now() - begin)
+                         .count();
+    }
+    if (syscalls >= 0) syscalls = write_syscalls() - syscalls;
+    QFile::remove(options.directory + "/" + log_name + ".txt");
+
+    std::vector<qint64> merged;
+    for (const std::vector<qint64> &samples : latencies) {
+        merged.insert(merged.end(), samples.begin(), samples.end());
+    }
+    std::sort(merged.begin(), merged.end());
+    qint64 total = merged.size();
+
+    BenchResult result;
+    result.add("suite", QString("log"));
+    result.add("case", bench.name);
+    result.add("api", QString(bench.builder ? "SB" : "S"));
+    result.add("colored", bench.colored);
+    result.add("console", bench.console);
+    result.add("file", bench.file);
+    result.add("flush_after", (qint64)bench.flush_after);
+    result.add("console_batch", (qint64)bench.console_batch);
+    result.add("async", bench.async);
+    result.add("threads", (qint64)bench.threads);
+    result.add("iterations", total);
+    result.add("ops_per_sec", total * 1e9 / qMax(elapsed_ns, (qint64)1));
+    result.add("p50_ns", percentile(merged, 0.50));
+    result.add("p90_ns", percentile(merged, 0.90));
+    result.add("p99_ns", percentile(merged, 0.99));
+    result.add("p999_ns", percentile(merged, 0.999));
+    result.add("max_ns", merged.empty() ? 0 : merged.back());
+    result.add("write_syscalls_per_100k",
+               syscalls < 0 ? -1 : syscalls * 100000 / qMax(total, 1LL));
+    return result;
+}
+
+template <typename Build>
+static BenchResult run_build_case(const BenchOptions &options,
+                                  const QString &name, Build build) {
+    qint64 checksum = 0;
+    Clock::time_point begin = Clock::now();
+    for (qint32 i = 0; i < options.iterations; ++i) {
+        checksum += build(i);
+    }
+    qint64 elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - begin)
+                            .count();
+    BenchResult result;
+    result.add("suite", QString("builder"));
+    result.add("case", name);
+    result.add("iterations", (qint64)options.iterations);
+    result.add("ns_per_op", (double)elapsed_ns / options.iterations);
+    result.add("checksum", checksum);
+    return result;
+}
+
+static QList<LogCase> make_log_cases(const BenchOptions &options) {
+    QList<LogCase> cases;
+    for (bool builder : {false, true}) {
+        for (bool colored : {false, true}) {
+            for (bool file : {false, true}) {
+                for (qint32 flush_after : {0, 64, 1024}) {
+                    if (!file && flush_after != 0) continue;
+                    LogCase bench;
+                    bench.builder = builder;
+                    bench.colored = colored;
+                    bench.console = true;
+                    bench.file = file;
+                    bench.flush_after = flush_after;
+                    bench.name = QString("%1_%2_%3_f%4")
+                                     .arg(builder ? "sb" : "s")
+                                     .arg(colored ? "colored" : "plain")
+                                     .arg(file ? "file" : "nofile")
+                                     .arg(flush_after);
+                    cases.push_back(bench);
+                }
+            }
+        }
+    }
+    for (qint32 console_batch : {0, 65536}) {
+        LogCase bench;
+        bench.console = true;
+        bench.flush_after = 1024;
+        bench.console_batch = console_batch;
+        bench.name = QString("syscalls_batch%1").arg(console_batch);
+        cases.push_back(bench);
+    }
+    for (bool async : {false, true}) {
+        for (qint32 threads = 1; threads <= options.max_threads; threads *= 2) {
+            LogCase bench;
+            bench.builder = true;
+            bench.flush_after = 1024;
+            bench.async = async;
+            bench.threads = threads;
+            bench.name = QString("scaling_%1_t%2")
+                             .arg(async ? "async" : "sync")
+                             .arg(threads);
+            cases.push_back(bench);
+        }
+    }
+    return cases;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    BenchOptions options;
+    for (int i = 1; i + 1 < args.size(); i += 2) {
+        if (args[i] == "--iterations") {
+            options.iterations = qMax(args[i + 1].toInt(), 1);
+        } else if (args[i] == "--threads") {
+            options.max_threads = qMax(args[i + 1].toInt(), 1);
+        } else if (args[i] == "--filter") {
+            options.filter = args[i + 1];
+        } else if (args[i] == "--output") {
+            options.output_path = args[i + 1];
+        } else {
+            err << "usage: " << args[0]
+                << " [--iterations N] [--threads N] [--filter text]"
+                   " [--output results.jsonl]\n"
+                << "log lines go to stdout, redirect it to /dev/null\n";
+            return 1;
+        }
+    }
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        err << "cannot create a temporary directory\n";
+        return 1;
+    }
+    options.directory = directory.path();
+
+    QFile output;
+    if (!options.output_path.isEmpty()) {
+        output.setFileName(options.output_path);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot open " << options.output_path << "\n";
+            return 1;
+        }
+    } else if (!output.open(stderr, QIODevice::WriteOnly)) {
+        return 1;
+    }
+
+    QList<BenchResult> results;
+    auto selected = [&](const QString &name) {
+        return options.filter.isEmpty() || name.contains(options.filter);
+    };
+    if (selected("builder_s")) {
+        results << run_build_case(options, "builder_s", [](qint32 i) {
+            S line = S("request ") + S(i, GREEN) + " from worker " + S(3) +
+                     " served in " + S(1.25) + "ms";
+            return (qint64)line.rawStr.size() + line.styStr.size();
+        });
+    }
+    if (selected("builder_sb")) {
+        results << run_build_case(options, "builder_sb", [](qint32 i) {
+            SB line = SB("request ") << SB(i, GREEN) << " from worker " << 3
+                                     << " served in " << 1.25 << "ms";
+            return (qint64)line.raw().size();
+        });
+    }
+    for (const LogCase &bench : make_log_cases(options)) {
+        if (selected(bench.name)) results << run_log_case(options, bench);
+    }
+
+    for (const BenchResult &result : results) {
+        output.write((result.json() + "\n").toUtf8());
+    }
+    output.flush();
+    return 0;
+}
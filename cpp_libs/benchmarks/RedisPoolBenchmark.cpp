@@ -0,0 +1,192 @@
+/*
+ * file name:       RedisPoolBenchmark.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../Database.h"
+#include "BenchResult.h"
+
+using namespace JDB;
+
+typedef std::chrono::steady_clock Clock;
+
+struct BenchOptions {
+    QString host = "127.0.0.1";
+    quint16 port = 6379;
+    qint32 iterations = 20000;
+    qint32 max_threads = 32;
+    quint32 pool_size = 8;
+    QString output_path;
+};
+
+enum class Mode { SHARED, PER_THREAD, POOL };
+
+static const char *mode_name(Mode mode) {
+    switch (mode) {
+        case Mode::SHARED:
+            return "shared";
+        case Mode::PER_THREAD:
+            return "per_thread";
+        default:
+            return "pool";
+    }
+}
+
+static bool round_trip(RedisController &controller, qint32 thread,
+                       qint32 index) {
+    QString key = QString("bench:pool:%1").arg(thread);
+    if (!controller.set(key, index)) return false;
+    return controller.get(key).toInt() == index;
+}
+
+static BenchResult run_case(const BenchOptions &options, Mode mode,
+                            qint32 threads) {
+    qint32 per_thread = qMax(options.iterations / threads, 1);
+    std::vector<std::vector<qint64>> latencies(threads);
+    std::atomic<qint64> failures{0};
+    std::atomic<qint64> timeouts{0};
+
+    RedisController shared(options.host, options.port);
+    std::mutex shared_lock;
+    std::unique_ptr<RedisPool> pool;
+    if (mode == Mode::SHARED) {
+        shared.connect();
+    } else if (mode == Mode::POOL) {
+        pool.reset(new RedisPool(options.host, options.port, "", "",
+                                 qMin(options.pool_size, (quint32)threads),
+                                 options.pool_size));
+    }
+
+    std::atomic<bool> start{false};
+    std::vector<std::thread> workers;
+    for (qint32 t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t]() {
+            RedisController own(options.host, options.port);
+            if (mode == Mode::PER_THREAD) own.connect();
+            std::vector<qint64> &samples = latencies[t];
+            samples.reserve(per_thread);
+            while (!start.load()) std::this_thread::yield();
+            for (qint32 i = 0; i < per_thread; ++i) {
+                Clock::time_point begin = Clock::now();
+                bool passed = false;
+                if (mode == Mode::SHARED) {
+                    std::lock_guard<std::mutex> guard(shared_lock);
+                    passed = round_trip(shared, t, i);
+                } else if (mode == Mode::PER_THREAD) {
+                    passed = round_trip(own, t, i);
+                } else {
+                    RedisPool::Lease lease = pool->acquire(1000);
+                    if (!lease) {
+                        timeouts.fetch_add(1);
+                        continue;
+                    }
+                    passed = round_trip(*lease, t, i);
+                }
+                if (!passed) failures.fetch_add(1);
+                samples.push_back(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Clock::now() - begin)
+                        .count());
+            }
+        });
+    }
+    Clock::time_point begin = Clock::now();
+    start.store(true);
+    for (std::thread &worker : workers) worker.join();
+    qint64 elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            Clock::now() - begin)
+                            .count();
+
+    std::vector<qint64> merged;
+    for (const std::vector<qint64> &samples : latencies) {
+        merged.insert(merged.end(), samples.begin(), samples.end());
+    }
+    std::sort(merged.begin(), merged.end());
+    qint64 total = merged.size();
+
+    BenchResult result;
+    result.add("suite", QString("redis_pool"));
+    result.add("mode", QString(mode_name(mode)));
+    result.add("threads", (qint64)threads);
+    result.add("pool_size", (qint64)options.pool_size);
+    result.add("iterations", total);
+    result.add("commands_per_sec",
+               total * 2e9 / qMax(elapsed_ns, (qint64)1));
+    result.add("p50_ns", percentile(merged, 0.50));
+    result.add("p99_ns", percentile(merged, 0.99));
+    result.add("max_ns", merged.empty() ? 0 : merged.back());
+    result.add("failures", failures.load());
+    result.add("timeouts", timeouts.load());
+    result.failed = failures.load() != 0;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    BenchOptions options;
+    for (int i = 1; i + 1 < args.size(); i += 2) {
+        if (args[i] == "--host") {
+            options.host = args[i + 1];
+        } else if (args[i] == "--port") {
+            options.port = args[i + 1].toUShort();
+        } else if (args[i] == "--iterations") {
+            options.iterations = qMax(args[i + 1].toInt(), 1);
+        } else if (args[i] == "--threads") {
+            options.max_threads = qMax(args[i + 1].toInt(), 1);
+        } else if (args[i] == "--pool-size") {
+            options.pool_size = qMax(args[i + 1].toUInt(), 1u);
+        } else if (args[i] == "--output") {
+            options.output_path = args[i + 1];
+        } else {
+            err << "usage: " << args[0]
+                << " [--host 127.0.0.1] [--port 6379] [--iterations N]"
+                   " [--threads N] [--pool-size N] [--output results.jsonl]\n";
+            return 1;
+        }
+    }
+
+    RedisController probe(options.host, options.port);
+    probe.connect();
+    if (!probe.ping()) {
+        err << "cannot reach redis-server at " << options.host << ":"
+            << options.port << "\n";
+        return 1;
+    }
+
+    QFile output;
+    if (!options.output_path.isEmpty()) {
+        output.setFileName(options.output_path);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot open " << options.output_path << "\n";
+            return 1;
+        }
+    } else if (!output.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+
+    bool passed = true;
+    for (Mode mode : {Mode::SHARED, Mode::PER_THREAD, Mode::POOL}) {
+        for (qint32 threads = 1; threads <= options.max_threads; threads *= 2) {
+            BenchResult result = run_case(options, mode, threads);
+            passed = passed && !result.failed;
+            output.write((result.json() + "\n").toUtf8());
+            output.flush();
+        }
+    }
+    return passed ? 0 : 2;
+}
@@ -0,0 +1,136 @@
+/*
+ * file name:       AsyncLoggerTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+#include <thread>
+#include <vector>
+
+#include "../Logging.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+struct Item {
+    qint32 thread;
+    qint32 index;
+};
+
+static QHash<QString, QVariant> make_config(const QTemporaryDir &temp,
+                                            OverflowPolicy policy,
+                                            qint32 queue_size) {
+    QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+    config["log_stored_path"] = temp.path() + "/";
+    config["log_add_date_to_suffix"] = false;
+    config["log_print_level"] = Level::CRIT;
+    config["log_flush_after_n_logs"] = 1 << 20;
+    config["async_mode"] = true;
+    config["async_queue_size"] = queue_size;
+    config["async_overflow_policy"] = policy;
+    return config;
+}
+
+static std::vector<Item> read_items(const QTemporaryDir &temp) {
+    std::vector<Item> items;
+    QFile file(temp.path() + "/logs.txt");
+    if (!file.open(QIODevice::ReadOnly)) return items;
+    QRegularExpression expression("item (\\d+) (\\d+)$");
+    for (const QString &line : QString::fromUtf8(file.readAll()).split('\n')) {
+        QRegularExpressionMatch match = expression.match(line);
+        if (match.hasMatch()) {
+            items.push_back(
+                {match.captured(1).toInt(), match.captured(2).toInt()});
+        }
+    }
+    return items;
+}
+
+static bool in_order(const std::vector<Item> &items, qint32 threads) {
+    std::vector<qint32> last(threads, -1);
+    for (const Item &item : items) {
+        if (item.thread >= threads || item.index <= last[item.thread]) {
+            return false;
+        }
+        last[item.thread] = item.index;
+    }
+    return true;
+}
+
+static void produce(Logger &logger, qint32 threads, qint32 per_thread) {
+    std::vector<std::thread> workers;
+    for (qint32 t = 0; t < threads; ++t) {
+        workers.emplace_back([&logger, t, per_thread]() {
+            for (qint32 i = 0; i < per_thread; ++i) {
+                logger.info(S("item ") + S(t) + " " + S(i));
+            }
+        });
+    }
+    for (std::thread &worker : workers) worker.join();
+}
+
+static void test_flush_drains_queue() {
+    QTemporaryDir temp;
+    Logger logger(make_config(temp, OverflowPolicy::BLOCK, 64));
+    produce(logger, 1, 2000);
+    logger.flushNow();
+    std::vector<Item> items = read_items(temp);
+    CHECK(items.size() == 2000);
+    CHECK(in_order(items, 1));
+}
+
+static void test_shutdown_drains_queue() {
+    QTemporaryDir temp;
+    {
+        Logger logger(make_config(temp, OverflowPolicy::BLOCK, 8192));
+        produce(logger, 1, 2000);
+    }
+    std::vector<Item> items = read_items(temp);
+    CHECK(items.size() == 2000);
+    CHECK(in_order(items, 1));
+}
+
+static void test_block_keeps_everything() {
+    QTemporaryDir temp;
+    quint64 dropped = 0;
+    {
+        Logger logger(make_config(temp, OverflowPolicy::BLOCK, 2));
+        produce(logger, 4, 500);
+        dropped = logger.droppedLogs();
+    }
+    std::vector<Item> items = read_items(temp);
+    CHECK(dropped == 0);
+    CHECK(items.size() == 2000);
+    CHECK(in_order(items, 4));
+}
+
+static void test_drop_policy(OverflowPolicy policy) {
+    QTemporaryDir temp;
+    quint64 dropped = 0;
+    {
+        Logger logger(make_config(temp, policy, 2));
+        produce(logger, 1, 1000);
+        dropped = logger.droppedLogs();
+    }
+    std::vector<Item> items = read_items(temp);
+    CHECK(items.size() + dropped == 1000);
+    CHECK(in_order(items, 1));
+    if (policy == OverflowPolicy::DROP_OLDEST) {
+        CHECK(!items.empty() && items.back().index == 999);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    test_flush_drains_queue();
+    test_shutdown_drains_queue();
+    test_block_keeps_everything();
+    test_drop_policy(OverflowPolicy::DROP_NEWEST);
+    test_drop_policy(OverflowPolicy::DROP_OLDEST);
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/*
+ * file name:       LogDecoderTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+
+#include "../Logging.h"
+#include "../tools/BinaryLogReader.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+static QString decode(const QString &format, const QByteArray &encoded,
+                      int count) {
+    BinaryReader reader(encoded);
+    QStringList args;
+    for (int i = 0; i < count; ++i) {
+        if (!read_arg(reader, args)) return QString();
+    }
+    CHECK(reader.pos == encoded.size());
+    return format_args(format, args);
+}
+
+static void test_placeholder_in_argument() {
+    QByteArray encoded;
+    binary_put(encoded, QString("user %1 said %2"));
+    binary_put(encoded, (qint64)42);
+    CHECK(decode("msg=[%1] code=%2", encoded, 2) ==
+          "msg=[user %1 said %2] code=42");
+}
+
+static void test_double_precision() {
+    QByteArray encoded;
+    binary_put(encoded, 0.1234567891);
+    binary_put(encoded, 0.1 + 0.2);
+    QString decoded = decode("%1 %2", encoded, 2);
+    CHECK(decoded.section(' ', 0, 0) == "0.1234567891");
+    CHECK(decoded.section(' ', 1, 1).toDouble() == 0.1 + 0.2);
+}
+
+static void test_mixed_arguments() {
+    QByteArray encoded;
+    binary_put(encoded, true);
+    binary_put(encoded, (quint64)18446744073709551615ull);
+    binary_put(encoded, "x");
+    CHECK(decode("%3 %1 %2 %4 100%", encoded, 3) ==
+          "x true 18446744073709551615 %4 100%");
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    test_placeholder_in_argument();
+    test_double_precision();
+    test_mixed_arguments();
+    return test_failures == 0 ? 0 : 1;
+}
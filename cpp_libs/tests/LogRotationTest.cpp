@@ -0,0 +1,73 @@
+/*
+ * file name:       LogRotationTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "../Logging.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+static void touch(const QString &path, const QDateTime &time = QDateTime()) {
+    QFile file(path);
+    file.open(QIODevice::WriteOnly);
+    file.write("x\n");
+    if (time.isValid()) {
+        file.setFileTime(time, QFileDevice::FileModificationTime);
+    }
+    file.close();
+}
+
+static void test_prune_keeps_neighbours() {
+    QTemporaryDir temp;
+    QString root = temp.path() + "/";
+    QString today = QDate::currentDate().toString("yyyy_MM_dd");
+    QDateTime past(QDate(2020, 1, 1), QTime(0, 0));
+
+    QStringList neighbours{"logs_" + today + ".jlog",
+                           "logs_" + today + ".jlog.idx", "logs.ring",
+                           "logs_backup.txt", "logs_" + today + ".txt.bak",
+                           "logs_notes.1.txt"};
+    for (const QString &file : neighbours) {
+        touch(root + file, past);
+    }
+    touch(root + "logs_2020_01_01.1.txt", past);
+    touch(root + "logs_2020_01_01.1.txt.idx", past);
+    touch(root + "logs_2020_01_01.txt.gz", past);
+
+    {
+        QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+        config["log_stored_path"] = root;
+        config["log_print_level"] = Level::CRIT;
+        config["log_rotate_size"] = 1;
+        config["log_keep_files"] = 2;
+        Logger logger(config);
+        for (qint32 i = 0; i < 6; ++i) {
+            logger.info(S("line ") + S(i));
+        }
+    }
+
+    for (const QString &file : neighbours) {
+        CHECK(QFile::exists(root + file));
+    }
+    CHECK(!QFile::exists(root + "logs_2020_01_01.1.txt"));
+    CHECK(!QFile::exists(root + "logs_2020_01_01.1.txt.idx"));
+    CHECK(!QFile::exists(root + "logs_2020_01_01.txt.gz"));
+    QStringList rotated = QDir(root).entryList(
+        QStringList{"logs_" + today + ".*.txt"}, QDir::Files);
+    CHECK(rotated.size() == 2);
+    CHECK(QFile::exists(root + "logs_" + today + ".txt"));
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    test_prune_keeps_neighbours();
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * file name:       LogStressTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTemporaryDir>
+#include <thread>
+#include <vector>
+
+#include "../Logging.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+static const qint32 LINES_PER_THREAD = 5000;
+
+static void run_stress(qint32 threads, qint32 flush_after, bool async) {
+    QTemporaryDir temp;
+    {
+        QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+        config["log_stored_path"] = temp.path() + "/";
+        config["log_add_date_to_suffix"] = false;
+        config["log_print_level"] = Level::CRIT;
+        config["log_flush_after_n_logs"] = flush_after;
+        config["async_mode"] = async;
+        Logger logger(config);
+        std::vector<std::thread> workers;
+        for (qint32 t = 0; t < threads; ++t) {
+            workers.emplace_back([&logger, t]() {
+                for (qint32 i = 0; i < LINES_PER_THREAD; ++i) {
+                    logger.info(SB("stress ") << t << " " << i << " "
+                                              << (t ^ i) << " end");
+                }
+            });
+        }
+        for (std::thread &worker : workers) worker.join();
+    }
+
+    std::vector<std::vector<quint8>> seen(
+        threads, std::vector<quint8>(LINES_PER_THREAD));
+    qint64 torn = 0, duplicated = 0, lost = 0;
+    QFile file(temp.path() + "/logs.txt");
+    CHECK(file.open(QIODevice::ReadOnly));
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.isEmpty()) continue;
+        QList<QByteArray> words = line.mid(line.indexOf("stress ")).split(' ');
+        bool valid = words.size() == 5 && words[4] == "end";
+        qint32 t = valid ? words[1].toInt(&valid) : -1;
+        qint32 i = valid ? words[2].toInt(&valid) : -1;
+        valid = valid && t >= 0 && t < threads && i >= 0 &&
+                i < LINES_PER_THREAD && words[3].toInt() == (t ^ i);
+        if (!valid) {
+            ++torn;
+        } else if (seen[t][i]++ > 0) {
+            ++duplicated;
+        }
+    }
+    for (const std::vector<quint8> &flags : seen) {
+        for (quint8 flag : flags) lost += flag == 0;
+    }
+    CHECK(torn == 0);
+    CHECK(duplicated == 0);
+    CHECK(lost == 0);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    for (qint32 threads : {2, 8, 32}) {
+        run_stress(threads, 0, false);
+        run_stress(threads, 256, false);
+    }
+    run_stress(8, 256, true);
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+/*
+ * file name:       LogSuppressionTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QRegularExpression>
+#include <QTemporaryDir>
+
+#include "../Logging.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+static QHash<QString, QVariant> make_config(const QTemporaryDir &temp) {
+    QHash<QString, QVariant> config = DEFAULT_LOG_CONFIG;
+    config["log_stored_path"] = temp.path() + "/";
+    config["log_add_date_to_suffix"] = false;
+    config["log_print_level"] = Level::CRIT;
+    config["file_log_level"] = Level::DEBUG;
+    return config;
+}
+
+static QStringList read_lines(const QTemporaryDir &temp) {
+    QFile file(temp.path() + "/logs.txt");
+    if (!file.open(QIODevice::ReadOnly)) return QStringList();
+    QStringList lines = QString::fromUtf8(file.readAll()).split('\n');
+    lines.removeAll(QString());
+    return lines;
+}
+
+static qint64 sum_counts(const QStringList &lines, const QString &pattern) {
+    QRegularExpression expression(pattern);
+    qint64 total = 0;
+    for (const QString &line : lines) {
+        QRegularExpressionMatch match = expression.match(line);
+        if (match.hasMatch()) total += match.captured(1).toLongLong();
+    }
+    return total;
+}
+
+static qint32 count_containing(const QStringList &lines, const QString &text) {
+    qint32 count = 0;
+    for (const QString &line : lines) {
+        if (line.contains(text)) ++count;
+    }
+    return count;
+}
+
+static void test_rate_limit() {
+    QTemporaryDir temp;
+    {
+        Logger logger(make_config(temp));
+        for (qint32 i = 0; i < 10; ++i) {
+            JLOG_RATE_LIMITED(logger, 2, Level::INFO, S("limited ") + S(i));
+        }
+    }
+    QStringList lines = read_lines(temp);
+    qint32 emitted = count_containing(lines, "limited ");
+    qint64 suppressed =
+        sum_counts(lines, "suppressed (\\d+) messages from .*:\\d+");
+    CHECK(emitted >= 2 && emitted < 10);
+    CHECK(emitted + suppressed == 10);
+}
+
+static void test_dedup() {
+    QTemporaryDir temp;
+    {
+        QHash<QString, QVariant> config = make_config(temp);
+        config["dedup_repeated"] = true;
+        Logger logger(config);
+        for (qint32 i = 0; i < 5; ++i) {
+            logger.warn(S("same line"));
+        }
+        logger.warn(S("other line"));
+        for (qint32 i = 0; i < 3; ++i) {
+            logger.warn(S("tail line"));
+        }
+    }
+    QStringList lines = read_lines(temp);
+    CHECK(count_containing(lines, "same line") == 1);
+    CHECK(count_containing(lines, "other line") == 1);
+    CHECK(count_containing(lines, "tail line") == 1);
+    CHECK(sum_counts(lines, "last message repeated (\\d+) times") == 6);
+}
+
+static void test_sampling() {
+    QTemporaryDir temp;
+    {
+        QHash<QString, QVariant> config = make_config(temp);
+        config["sample_rate_debug"] = 0.0;
+        Logger logger(config);
+        for (qint32 i = 0; i < 7; ++i) {
+            logger.debug(S("sampled ") + S(i));
+        }
+        logger.info(S("kept"));
+    }
+    QStringList lines = read_lines(temp);
+    CHECK(count_containing(lines, "sampled ") == 0);
+    CHECK(count_containing(lines, "kept") == 1);
+    CHECK(sum_counts(lines, "dropped (\\d+) debug/info messages") == 7);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    test_rate_limit();
+    test_dedup();
+    test_sampling();
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,94 @@
+/*
+ * file name:       RedisBulkTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <iostream>
+
+#include "../Database.h"
+#include "TestCheck.h"
+
+using namespace JDB;
+
+static const QString PREFIX = "jdb:test:bulk:";
+static const QString HASH = "jdb:test:bulk-hash";
+
+static QList<QString> make_keys(int count) {
+    QList<QString> keys;
+    for (int i = 0; i < count; ++i) {
+        keys.push_back(PREFIX + QString::number(i));
+    }
+    return keys;
+}
+
+// mset and mget split at REDIS_BULK_CHUNK, every value must come back in the
+// order of the keys no matter which chunk it landed in.
+static void test_mset_mget(RedisController &redis, int count) {
+    QList<QString> keys = make_keys(count);
+    QHash<QString, QVariant> data;
+    for (int i = 0; i < count; ++i) {
+        data[keys[i]] = "value" + QString::number(i);
+    }
+    CHECK(redis.mset(data));
+
+    QList<QString> asked = keys;
+    asked.push_back(PREFIX + "missing");
+    QList<QVariant> values = redis.mget(asked);
+    CHECK(values.size() == count + 1);
+    int wrong = 0;
+    for (int i = 0; i < count && i < values.size(); ++i) {
+        wrong += values[i].toString() != "value" + QString::number(i);
+    }
+    CHECK(wrong == 0);
+    CHECK(!values.isEmpty() && values.back().isNull());
+}
+
+static void test_del_unlink(RedisController &redis, int count) {
+    QList<QString> keys = make_keys(count);
+    QList<QString> half = keys.mid(0, count / 2);
+    QList<QString> rest = keys.mid(count / 2);
+    CHECK(redis.del(half) == (quint64)half.size());
+    CHECK(redis.unlink(rest) == (quint64)rest.size());
+    CHECK(redis.del(keys) == 0);
+}
+
+static void test_hset(RedisController &redis, int count) {
+    QHash<QString, QVariant> fields;
+    for (int i = 0; i < count; ++i) {
+        fields["field" + QString::number(i)] = i;
+    }
+    CHECK(redis.hset(HASH, fields) == count);
+    CHECK(redis.hset(HASH, fields) == 0);
+    CHECK(redis.hgetall(HASH).size() == count);
+    redis.del({HASH});
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    RedisController redis("127.0.0.1");
+    redis.connect();
+    if (!redis.getConnected() || !redis.ping()) {
+        std::cout << "skipped: no redis-server on 127.0.0.1:6379"
+                  << std::endl;
+        return TEST_SKIPPED;
+    }
+    redis.del(make_keys(2 * REDIS_BULK_CHUNK + 1) << HASH);
+
+    const int counts[] = {1,
+                          REDIS_BULK_CHUNK - 1,
+                          REDIS_BULK_CHUNK,
+                          REDIS_BULK_CHUNK + 1,
+                          2 * REDIS_BULK_CHUNK + 1};
+    for (int count : counts) {
+        test_mset_mget(redis, count);
+        test_del_unlink(redis, count);
+        test_hset(redis, count);
+    }
+    CHECK(redis.mset(QHash<QString, QVariant>()));
+    CHECK(redis.mget(QList<QString>()).isEmpty());
+    CHECK(redis.del(QList<QString>()) == 0);
+    return test_failures == 0 ? 0 : 1;
+}
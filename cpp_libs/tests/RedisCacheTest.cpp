@@ -0,0 +1,104 @@
+/*
+ * file name:       RedisCacheTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "../Database.h"
+#include "TestCheck.h"
+
+using namespace JDB;
+
+static const QString KEY = "jdb:test:cache";
+static const QString HASH = "jdb:test:cache:hash";
+
+// redis takes a moment to deliver the invalidation to the tracking
+// connection, so keep reading until the new value shows up.
+static QVariant read_until(RedisController &redis, const QString &expected) {
+    QVariant value;
+    for (int i = 0; i < 100; ++i) {
+        value = redis.get(KEY);
+        if (value.toString() == expected) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return value;
+}
+
+static void test_invalidation(RedisController &cached,
+                              RedisController &writer) {
+    CHECK(writer.set(KEY, "first"));
+    CHECK(cached.get(KEY).toString() == "first");
+    CHECK(cached.get(KEY).toString() == "first");
+    RedisCacheStats before = cached.getCacheStats();
+    CHECK(before.hits >= 1);
+
+    CHECK(writer.set(KEY, "second"));
+    CHECK(read_until(cached, "second").toString() == "second");
+    RedisCacheStats after = cached.getCacheStats();
+    CHECK(after.invalidations > before.invalidations);
+    CHECK(after.misses > before.misses);
+}
+
+static void test_replies_keep_resp2_shapes(RedisController &cached) {
+    // tracking must not switch the connection to RESP3, where hgetall
+    // would come back as a map instead of a flat array.
+    RedisReply reply = cached.runredis(RedisCommand("hgetall") << HASH);
+    CHECK(reply.view().type() == RedisDataType::Array);
+}
+
+static void test_byte_accounting(RedisController &cached,
+                                 RedisController &writer) {
+    CHECK(writer.set(KEY, QString(100, 'a')));
+    CHECK(writer.hset(HASH, "field", QString(100, 'b')));
+    CHECK(cached.get(KEY).toString().size() == 100);
+    CHECK(cached.hget(HASH, "field").toString().size() == 100);
+    qint64 settled = cached.getCacheStats().bytes;
+    CHECK(settled > 200);
+
+    // every refresh replaces the cached value, so the cost must not grow.
+    for (int i = 0; i < 50; ++i) {
+        CHECK(writer.set(KEY, QString(100, QChar('a' + i % 26))));
+        writer.hset(HASH, "field", QString(100, QChar('b' + i % 24)));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        cached.get(KEY);
+        cached.hget(HASH, "field");
+    }
+    RedisCacheStats stats = cached.getCacheStats();
+    CHECK(stats.entries <= 2);
+    CHECK(stats.bytes <= settled);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    RedisController writer("127.0.0.1");
+    writer.connect();
+    if (!writer.getConnected() || !writer.ping()) {
+        std::cout << "skipped: no redis-server on 127.0.0.1:6379"
+                  << std::endl;
+        return TEST_SKIPPED;
+    }
+    writer.del({KEY, HASH});
+
+    RedisController cached("127.0.0.1");
+    cached.setCache(1 << 20);
+    cached.connect();
+    CHECK(cached.getCaching());
+    if (cached.getCaching()) {
+        test_invalidation(cached, writer);
+        test_replies_keep_resp2_shapes(cached);
+        test_byte_accounting(cached, writer);
+    }
+    cached.setCache(0);
+    CHECK(!cached.getCaching());
+
+    writer.del({KEY, HASH});
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+/*
+ * file name:       RedisPipelineTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <iostream>
+
+#include "../Database.h"
+#include "TestCheck.h"
+
+using namespace JDB;
+
+static const QString KEY = "jdb:test:pipeline";
+static const QString TEXT = "jdb:test:pipeline-text";
+
+// an error in the middle of a plain pipeline only affects its own reply.
+static void test_plain_error(RedisController &redis) {
+    RedisPipeline pipeline(redis);
+    pipeline << (RedisCommand("set") << KEY << 1)
+             << (RedisCommand("incr") << TEXT)
+             << (RedisCommand("incr") << KEY);
+    CHECK(redis.set(TEXT, "text"));
+    CHECK(pipeline.exec());
+    CHECK(pipeline.ok(0));
+    CHECK(pipeline.isError(1));
+    CHECK(pipeline.type(2) == RedisDataType::Integer);
+    CHECK(pipeline.integer(2) == 2);
+}
+
+// a command that fails while EXEC runs is reported in its slot, the rest of
+// the transaction still applies.
+static void test_exec_error(RedisController &redis) {
+    CHECK(redis.set(TEXT, "text"));
+    RedisPipeline pipeline(redis, true);
+    pipeline << (RedisCommand("set") << KEY << 10)
+             << (RedisCommand("incr") << TEXT)
+             << (RedisCommand("incr") << KEY);
+    CHECK(pipeline.exec());
+    CHECK(pipeline.ok(0));
+    CHECK(pipeline.isError(1));
+    CHECK(pipeline.integer(2) == 11);
+    CHECK(redis.get(KEY).toLongLong() == 11);
+}
+
+// a command redis rejects while queueing aborts the whole transaction with
+// EXECABORT, so exec() fails, nothing is applied and there are no results.
+static void test_queue_error(RedisController &redis) {
+    CHECK(redis.set(KEY, 1));
+    RedisPipeline pipeline(redis, true);
+    pipeline << (RedisCommand("incr") << KEY)
+             << RedisCommand("jdb-no-such-command")
+             << (RedisCommand("incr") << KEY);
+    CHECK(!pipeline.exec());
+    CHECK(pipeline.type(0) == RedisDataType::Nil);
+    CHECK(redis.get(KEY).toLongLong() == 1);
+
+    // the connection is usable again after the aborted transaction.
+    CHECK(redis.ping());
+    RedisPipeline next(redis, true);
+    next << (RedisCommand("incr") << KEY);
+    CHECK(next.exec());
+    CHECK(next.integer(0) == 2);
+}
+
+static void test_empty(RedisController &redis) {
+    RedisPipeline pipeline(redis, true);
+    CHECK(pipeline.exec());
+    CHECK(pipeline.size() == 0);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    RedisController redis("127.0.0.1");
+    redis.connect();
+    if (!redis.getConnected() || !redis.ping()) {
+        std::cout << "skipped: no redis-server on 127.0.0.1:6379"
+                  << std::endl;
+        return TEST_SKIPPED;
+    }
+    test_plain_error(redis);
+    test_exec_error(redis);
+    test_queue_error(redis);
+    test_empty(redis);
+    redis.del({KEY, TEXT});
+    return test_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/*
+ * file name:       RedisPoolTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <iostream>
+
+#include "../Database.h"
+#include "TestCheck.h"
+
+using namespace JDB;
+
+static void test_acquire_times_out() {
+    RedisPool pool("127.0.0.1", 6379, "", "", 1, 1);
+    RedisPool::Lease held = pool.acquire();
+    CHECK(held.isValid());
+
+    QElapsedTimer waited;
+    waited.start();
+    RedisPool::Lease missing = pool.acquire(50);
+    CHECK(!missing.isValid());
+    CHECK(waited.elapsed() >= 45);
+    CHECK(waited.elapsed() < 1000);
+}
+
+static void test_lease_returns() {
+    RedisPool pool("127.0.0.1", 6379, "", "", 1, 2);
+    CHECK(pool.size() == 1);
+    RedisController *first = nullptr;
+    {
+        RedisPool::Lease lease = pool.acquire();
+        CHECK(lease.isValid());
+        CHECK(pool.idleSize() == 0);
+        first = &*lease;
+    }
+    CHECK(pool.idleSize() == 1);
+
+    RedisPool::Lease again = pool.acquire();
+    CHECK(&*again == first);
+    RedisPool::Lease moved = std::move(again);
+    CHECK(!again.isValid());
+    moved.release();
+    CHECK(!moved.isValid());
+    CHECK(pool.idleSize() == 1);
+    CHECK(pool.size() == 1);
+}
+
+static void test_broken_connection_is_replaced() {
+    RedisPool pool("127.0.0.1", 6379, "", "", 1, 2);
+    {
+        RedisPool::Lease victim = pool.acquire();
+        RedisPool::Lease killer = pool.acquire();
+        CHECK(victim.isValid() && killer.isValid());
+        qint64 id = victim->runredis(RedisCommand("client") << "id")
+                        .view()
+                        .integer();
+        killer->runredis(RedisCommand("client") << "kill" << "id" << id);
+        victim->ping();
+        CHECK(victim->getFailed());
+    }
+    // the broken one is dropped on return and min_size is kept warm.
+    CHECK(pool.size() >= 1);
+    for (quint32 i = 0; i < pool.size(); ++i) {
+        RedisPool::Lease lease = pool.acquire();
+        CHECK(lease.isValid() && !lease->getFailed());
+        CHECK(lease->ping());
+    }
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    RedisController probe("127.0.0.1");
+    probe.connect();
+    if (!probe.getConnected() || !probe.ping()) {
+        std::cout << "skipped: no redis-server on 127.0.0.1:6379"
+                  << std::endl;
+        return TEST_SKIPPED;
+    }
+    test_acquire_times_out();
+    test_lease_returns();
+    test_broken_connection_is_replaced();
+    return test_failures == 0 ? 0 : 1;
+}
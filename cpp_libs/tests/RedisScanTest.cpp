@@ -0,0 +1,109 @@
+/*
+ * file name:       RedisScanTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QSet>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "../Database.h"
+#include "TestCheck.h"
+
+using namespace JDB;
+
+static const QString PREFIX = "jdb:test:scan:";
+static const QString EXTRA = "jdb:test:scan-extra:";
+static const int KEYS = 5000;
+
+static QList<QString> make_keys(const QString &prefix, int count) {
+    QList<QString> keys;
+    for (int i = 0; i < count; ++i) {
+        keys.push_back(prefix + QString::number(i));
+    }
+    return keys;
+}
+
+static bool unique(const QList<QString> &keys) {
+    QSet<QString> seen;
+    for (const QString &key : keys) {
+        seen.insert(key);
+    }
+    return seen.size() == keys.size();
+}
+
+static void test_keys_complete(RedisController &redis) {
+    QList<QString> keys = redis.keys(PREFIX + "*");
+    CHECK(keys.size() == KEYS);
+    CHECK(unique(keys));
+}
+
+// SCAN may return a key twice while the keyspace is resized underneath it,
+// so keys() has to de-duplicate and still report every key that was there
+// for the whole scan.
+static void test_keys_while_growing(RedisController &redis) {
+    std::atomic<bool> done{false};
+    std::thread writer([&done] {
+        RedisController other("127.0.0.1");
+        other.connect();
+        QHash<QString, QVariant> data;
+        int i = 0;
+        while (!done.load() && i < 20 * KEYS) {
+            data.clear();
+            for (int j = 0; j < 500; ++j, ++i) {
+                data[EXTRA + QString::number(i)] = i;
+            }
+            other.mset(data);
+        }
+    });
+    for (int round = 0; round < 5; ++round) {
+        QList<QString> keys = redis.keys(PREFIX + "*");
+        CHECK(keys.size() == KEYS);
+        CHECK(unique(keys));
+    }
+    done.store(true);
+    writer.join();
+
+    QList<QString> extra = redis.keys(EXTRA + "*");
+    CHECK(unique(extra));
+    redis.unlink(extra);
+}
+
+static void test_scan_pattern(RedisController &redis) {
+    qint64 seen = 0;
+    for (const RedisScanItem &item : redis.scanKeys(PREFIX + "1*", 100)) {
+        seen += item.key.startsWith(PREFIX + "1");
+    }
+    // 1, 10-19, 100-199 and 1000-1999 below 5000.
+    CHECK(seen >= 1111);
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    RedisController redis("127.0.0.1");
+    redis.connect();
+    if (!redis.getConnected() || !redis.ping()) {
+        std::cout << "skipped: no redis-server on 127.0.0.1:6379"
+                  << std::endl;
+        return TEST_SKIPPED;
+    }
+    QList<QString> keys = make_keys(PREFIX, KEYS);
+    redis.unlink(keys);
+    redis.unlink(redis.keys(EXTRA + "*"));
+    QHash<QString, QVariant> data;
+    for (const QString &key : keys) {
+        data[key] = 1;
+    }
+    CHECK(redis.mset(data));
+
+    test_keys_complete(redis);
+    test_keys_while_growing(redis);
+    test_scan_pattern(redis);
+
+    redis.unlink(keys);
+    return test_failures == 0 ? 0 : 1;
+}
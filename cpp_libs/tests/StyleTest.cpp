@@ -0,0 +1,62 @@
+/*
+ * file name:       StyleTest.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <thread>
+
+#include "../Logging.h"
+#include "TestCheck.h"
+
+using namespace JLogs;
+
+static bool same_bytes(const SB &builder, const S &styled) {
+    return builder.raw() == styled.rawStr.toUtf8() &&
+           builder.styledBytes() == styled.styStr.toUtf8();
+}
+
+static void test_unstyled() {
+    CHECK(same_bytes(SB("plain"), S("plain")));
+    CHECK(same_bytes(SB(QString("text")), S(QString("text"))));
+    CHECK(same_bytes(SB(42), S(42)));
+    CHECK(!SB("plain").styledBytes().contains(CLEAR));
+}
+
+static void test_styled() {
+    CHECK(same_bytes(SB("alert", RED), S("alert", RED)));
+    CHECK(same_bytes(SB("alert", RED, BOLD), S("alert", RED, BOLD)));
+    CHECK(same_bytes(SB(7, BRIGHT_RED), S(7, BRIGHT_RED)));
+}
+
+static void test_concatenated() {
+    CHECK(same_bytes(SB("a") + SB("b", RED) + "c",
+                     S("a") + S("b", RED) + "c"));
+}
+
+// built before the thread's SB pool, so it is destroyed after the pool and
+// must not hand its storage back to it.
+struct LateBuilder {
+    SB builder;
+};
+
+static void test_outlives_pool() {
+    std::thread worker([] {
+        static thread_local LateBuilder late;
+        late.builder << SB("late", RED);
+        SB pooled("pooled");
+        CHECK(same_bytes(late.builder, S("late", RED)));
+    });
+    worker.join();
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    test_unstyled();
+    test_styled();
+    test_concatenated();
+    test_outlives_pool();
+    return test_failures == 0 ? 0 : 1;
+}
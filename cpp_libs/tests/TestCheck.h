@@ -0,0 +1,27 @@
+/*
+ * file name:       TestCheck.h
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <iostream>
+
+static int test_failures = 0;
+
+// ctest reports tests returning this as skipped, see SKIP_RETURN_CODE.
+static const int TEST_SKIPPED = 77;
+
+#define CHECK(condition)                                                 \
+    do {                                                                 \
+        if (!(condition)) {                                              \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " \
+                      << #condition << std::endl;                        \
+            ++test_failures;                                             \
+        }                                                                \
+    } while (0)
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * file name:       BinaryLogReader.h
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#ifndef BINARY_LOG_READER_H
+#define BINARY_LOG_READER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <cstring>
+
+#include "../Logging.h"
+
+struct BinaryReader {
+    const QByteArray &data;
+    int pos = 0;
+
+    BinaryReader(const QByteArray &data) : data(data) {}
+
+    bool has(int size) const { return this->pos + size <= this->data.size(); }
+    quint64 le(int bytes) {
+        quint64 value = 0;
+        for (int i = 0; i < bytes; ++i) {
+            value |= (quint64)(quint8)this->data[this->pos + i] << (8 * i);
+        }
+        this->pos += bytes;
+        return value;
+    }
+};
+
+inline QString format_double(double number) {
+    QString text = QString::number(number, 'g', 15);
+    if (text.toDouble() != number) {
+        text = QString::number(number, 'g', 17);
+    }
+    return text;
+}
+
+inline bool read_arg(BinaryReader &reader, QStringList &args) {
+    if (!reader.has(1)) return false;
+    quint8 type = reader.le(1);
+    switch (type) {
+        case JLogs::BinaryArgType::ARG_INT:
+            if (!reader.has(8)) return false;
+            args.append(QString::number((qint64)reader.le(8)));
+            return true;
+        case JLogs::BinaryArgType::ARG_UINT:
+            if (!reader.has(8)) return false;
+            args.append(QString::number((quint64)reader.le(8)));
+            return true;
+        case JLogs::BinaryArgType::ARG_DOUBLE: {
+            if (!reader.has(8)) return false;
+            quint64 bits = reader.le(8);
+            double number;
+            memcpy(&number, &bits, sizeof(number));
+            args.append(format_double(number));
+            return true;
+        }
+        case JLogs::BinaryArgType::ARG_BOOL:
+            if (!reader.has(1)) return false;
+            args.append(reader.le(1) ? "true" : "false");
+            return true;
+        case JLogs::BinaryArgType::ARG_STRING: {
+            if (!reader.has(4)) return false;
+            quint32 size = reader.le(4);
+            if (!reader.has(size)) return false;
+            args.append(
+                QString::fromUtf8(reader.data.constData() + reader.pos, size));
+            reader.pos += size;
+            return true;
+        }
+        default:
+            return false;
+    }
+}
+
+// substitutes every %N in one pass so placeholders inside the arguments
+// themselves are left alone.
+inline QString format_args(const QString &format, const QStringList &args) {
+    QString message;
+    message.reserve(format.size());
+    int size = format.size();
+    for (int i = 0; i < size; ++i) {
+        if (format[i] == '%' && i + 1 < size && format[i + 1].isDigit()) {
+            int number = format[i + 1].digitValue();
+            int length = 2;
+            if (i + 2 < size && format[i + 2].isDigit()) {
+                number = number * 10 + format[i + 2].digitValue();
+                length = 3;
+            }
+            if (number >= 1 && number <= args.size()) {
+                message += args[number - 1];
+                i += length - 1;
+                continue;
+            }
+        }
+        message += format[i];
+    }
+    return message;
+}
+
+#endif
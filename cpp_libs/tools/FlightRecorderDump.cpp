@@ -0,0 +1,89 @@
+/*
+ * file name:       FlightRecorderDump.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <algorithm>
+
+#include "../Logging.h"
+
+using namespace JLogs;
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    if (args.size() < 2) {
+        err << "usage: " << args[0] << " <file.ring> [output.txt]\n";
+        return 1;
+    }
+
+    QFile input(args[1]);
+    if (!input.open(QIODevice::ReadOnly)) {
+        err << "cannot open " << args[1] << "\n";
+        return 1;
+    }
+    QByteArray data = input.readAll();
+    const FlightRecorderHeader *header =
+        (const FlightRecorderHeader *)data.constData();
+    if (data.size() < (int)FLIGHT_RECORDER_HEADER_SIZE ||
+        !data.startsWith(FLIGHT_RECORDER_MAGIC)) {
+        err << args[1] << " is not a flight recorder file\n";
+        return 1;
+    }
+    quint32 slot_count = header->slot_count;
+    quint32 slot_size = header->slot_size;
+    if (slot_size <= FLIGHT_RECORDER_SLOT_HEADER_SIZE ||
+        data.size() < (qint64)FLIGHT_RECORDER_HEADER_SIZE +
+                          (qint64)slot_count * slot_size) {
+        err << args[1] << " is truncated\n";
+        return 1;
+    }
+
+    QFile output;
+    if (args.size() > 2) {
+        output.setFileName(args[2]);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot open " << args[2] << "\n";
+            return 1;
+        }
+    } else if (!output.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+
+    QList<QPair<quint64, const char *>> records;
+    for (quint32 i = 0; i < slot_count; ++i) {
+        const char *base =
+            data.constData() + FLIGHT_RECORDER_HEADER_SIZE + i * slot_size;
+        quint64 sequence =
+            ((const FlightRecorderSlot *)base)->sequence.load();
+        if (sequence != 0) {
+            records.push_back({sequence, base});
+        }
+    }
+    std::sort(records.begin(), records.end(),
+              [](const QPair<quint64, const char *> &lvalue,
+                 const QPair<quint64, const char *> &rvalue) {
+                  return lvalue.first < rvalue.first;
+              });
+
+    for (const QPair<quint64, const char *> &slot : records) {
+        const FlightRecorderSlot *record =
+            (const FlightRecorderSlot *)slot.second;
+        quint16 size = qMin<quint32>(
+            record->size, slot_size - FLIGHT_RECORDER_SLOT_HEADER_SIZE);
+        output.write(slot.second + FLIGHT_RECORDER_SLOT_HEADER_SIZE, size);
+        if (size == 0 ||
+            slot.second[FLIGHT_RECORDER_SLOT_HEADER_SIZE + size - 1] != '\n') {
+            output.write("\n", 1);
+        }
+    }
+    err << records.size() << " of " << header->write_index.load()
+        << " records recovered\n";
+    return 0;
+}
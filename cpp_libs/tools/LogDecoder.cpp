@@ -0,0 +1,115 @@
+/*
+ * file name:       LogDecoder.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+
+#include "../Logging.h"
+#include "BinaryLogReader.h"
+
+using namespace JLogs;
+
+static QString config_text(const QString &key) {
+    return DEFAULT_LOG_CONFIG.value(key).toString();
+}
+
+static QString make_prefix_raw(qint64 msecs, Level level, Tag tag) {
+    QString prefix;
+    if (DEFAULT_LOG_CONFIG.value("display_time").toBool()) {
+        bool quote = DEFAULT_LOG_CONFIG.value("time_quote").toBool();
+        prefix += (quote ? config_text("time_quote_begin") : "") +
+                  QDateTime::fromMSecsSinceEpoch(msecs).toString(
+                      config_text("time_format")) +
+                  (quote ? config_text("time_quote_end") : "") + " ";
+    }
+    if (DEFAULT_LOG_CONFIG.value("display_levels").toBool()) {
+        prefix +=
+            config_text(QString("level_%1_text").arg(LEVELS_MAP[level])) + " ";
+    }
+    if (DEFAULT_LOG_CONFIG.value("display_tags").toBool() &&
+        tag != Tag::NO_TAG) {
+        prefix += config_text(QString("tag_%1_text").arg(TAGS_MAP[tag])) + " ";
+    }
+    return prefix;
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    if (args.size() < 2) {
+        err << "usage: " << args[0] << " <file.jlog> [output.txt]\n";
+        return 1;
+    }
+
+    QFile input(args[1]);
+    if (!input.open(QIODevice::ReadOnly)) {
+        err << "cannot open " << args[1] << "\n";
+        return 1;
+    }
+    QByteArray data = input.readAll();
+    if (!data.startsWith(BINARY_LOG_MAGIC)) {
+        err << args[1] << " is not a binary log file\n";
+        return 1;
+    }
+
+    QFile output;
+    if (args.size() > 2) {
+        output.setFileName(args[2]);
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "cannot open " << args[2] << "\n";
+            return 1;
+        }
+    } else if (!output.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+
+    QHash<quint32, QString> formats;
+    BinaryReader reader(data);
+    reader.pos = BINARY_LOG_MAGIC.size();
+    qint64 decoded = 0;
+    while (reader.has(1)) {
+        quint8 type = reader.le(1);
+        if (type == BinaryRecordType::FORMAT_RECORD) {
+            if (!reader.has(8)) break;
+            quint32 format_id = reader.le(4);
+            quint32 size = reader.le(4);
+            if (!reader.has(size)) break;
+            formats[format_id] =
+                QString::fromUtf8(data.constData() + reader.pos, size);
+            reader.pos += size;
+        } else if (type == BinaryRecordType::LOG_RECORD) {
+            if (!reader.has(16)) break;
+            quint32 format_id = reader.le(4);
+            qint64 msecs = reader.le(8);
+            Level level = (Level)reader.le(1);
+            Tag tag = (Tag)reader.le(1);
+            quint16 arg_count = reader.le(2);
+            QStringList message_args;
+            bool complete = true;
+            for (quint16 i = 0; i < arg_count && complete; ++i) {
+                complete = read_arg(reader, message_args);
+            }
+            if (!complete) break;
+            QString message =
+                format_args(formats.value(format_id), message_args);
+            output.write(
+                (make_prefix_raw(msecs, level, tag) + message + "\n").toUtf8());
+            ++decoded;
+        } else {
+            err << "corrupted record at offset " << reader.pos - 1 << "\n";
+            return 1;
+        }
+    }
+    if (reader.pos < data.size()) {
+        err << "truncated record at offset " << reader.pos << "\n";
+    }
+    err << decoded << " records decoded\n";
+    return 0;
+}
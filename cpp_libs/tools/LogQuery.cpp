@@ -0,0 +1,231 @@
+/*
+ * file name:       LogQuery.cpp
+ * created at:      2024/01/18
+ * last modified:   2024/01/20
+ * author:          lupnis<lupnisj@gmail.com>
+ */
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QFile>
+#include <QTextStream>
+#include <climits>
+#include <cstring>
+
+#include "../Logging.h"
+
+using namespace JLogs;
+
+// text line times may be truncated to whole seconds, so a line can read up to
+// a second earlier than the record time kept in its index block.
+static const qint64 LINE_TIME_TRUNCATION_MS = 1000;
+
+struct LineFormat {
+    bool json = false;
+    QString time_format;
+    QByteArray time_open;
+    int time_size = 0;
+    int level_offset = 0;
+    QByteArray levels[LEVEL_COUNT];
+};
+
+struct QueryFilter {
+    qint64 from = LLONG_MIN;
+    qint64 to = LLONG_MAX;
+    quint32 level = Level::DEBUG;
+};
+
+static QString config_text(const QString &key) {
+    return DEFAULT_LOG_CONFIG.value(key).toString();
+}
+
+static LineFormat make_line_format(bool json) {
+    LineFormat format;
+    format.json = json;
+    for (int level = 0; level < LEVEL_COUNT; ++level) {
+        format.levels[level] =
+            json ? QByteArray("\"") + LEVELS_MAP[(Level)level].toUtf8() + "\""
+                 : config_text(QString("level_%1_text")
+                                   .arg(LEVELS_MAP[(Level)level]))
+                       .toUtf8();
+    }
+    if (json) return format;
+
+    bool quote = DEFAULT_LOG_CONFIG.value("time_quote").toBool();
+    format.time_format = config_text("time_format");
+    format.time_open = quote ? config_text("time_quote_begin").toUtf8() : "";
+    format.time_size =
+        QDateTime::currentDateTime().toString(format.time_format).size();
+    format.level_offset =
+        format.time_open.size() + format.time_size +
+        (quote ? config_text("time_quote_end").toUtf8().size() : 0) + 1;
+    return format;
+}
+
+static bool parse_line(const LineFormat &format, const char *line, int size,
+                       qint64 &msecs, quint32 &level) {
+    static const char JSON_TIME[] = "{\"time\":\"";
+    static const char JSON_LEVEL[] = ",\"level\":";
+    QByteArray text = QByteArray::fromRawData(line, size);
+    int level_pos = format.level_offset;
+    QDateTime time;
+    if (format.json) {
+        if (!text.startsWith(JSON_TIME) || size < 34) return false;
+        time = QDateTime::fromString(QString::fromLatin1(line + 9, 24),
+                                     Qt::ISODateWithMs);
+        level_pos = text.indexOf(JSON_LEVEL);
+        if (level_pos >= 0) level_pos += sizeof(JSON_LEVEL) - 1;
+    } else {
+        if (!text.startsWith(format.time_open) ||
+            size < format.time_open.size() + format.time_size) {
+            return false;
+        }
+        time = QDateTime::fromString(
+            QString::fromUtf8(line + format.time_open.size(), format.time_size),
+            format.time_format);
+    }
+    if (!time.isValid()) return false;
+    msecs = time.toMSecsSinceEpoch();
+    level = Level::INFO;
+    for (int candidate = 0; level_pos >= 0 && candidate < LEVEL_COUNT;
+         ++candidate) {
+        const QByteArray &name = format.levels[candidate];
+        if (level_pos + name.size() <= size &&
+            memcmp(line + level_pos, name.constData(), name.size()) == 0) {
+            level = candidate;
+            break;
+        }
+    }
+    return true;
+}
+
+static qint64 scan_range(const LineFormat &format, const QueryFilter &filter,
+                         const char *data, qint64 begin, qint64 end,
+                         QFile &output) {
+    qint64 matched = 0;
+    qint64 msecs = LLONG_MIN;
+    quint32 level = Level::INFO;
+    bool keep = false;
+    qint64 run = begin;
+    for (qint64 pos = begin; pos < end;) {
+        const char *line = data + pos;
+        const char *newline = (const char *)memchr(line, '\n', end - pos);
+        qint64 size = newline != nullptr ? newline - line + 1 : end - pos;
+        bool was_kept = keep;
+        if (parse_line(format, line, size, msecs, level)) {
+            keep = msecs >= filter.from && msecs <= filter.to &&
+                   level >= filter.level;
+            matched += keep ? 1 : 0;
+        }
+        if (keep != was_kept) {
+            if (was_kept) output.write(data + run, pos - run);
+            run = pos;
+        }
+        pos += size;
+    }
+    if (keep) output.write(data + run, end - run);
+    return matched;
+}
+
+static bool parse_time(const QString &text, qint64 &msecs) {
+    bool is_number = false;
+    msecs = text.toLongLong(&is_number);
+    if (is_number) return true;
+    QDateTime time = QDateTime::fromString(text, Qt::ISODateWithMs);
+    if (!time.isValid()) time = QDateTime::fromString(text, Qt::ISODate);
+    msecs = time.toMSecsSinceEpoch();
+    return time.isValid();
+}
+
+int main(int argc, char *argv[]) {
+    QCoreApplication app(argc, argv);
+    QStringList args = QCoreApplication::arguments();
+    QTextStream err(stderr);
+    if (args.size() < 2) {
+        err << "usage: " << args[0]
+            << " <log file> [--from <time>] [--to <time>] [--level <level>]\n"
+            << "time is epoch milliseconds or ISO 8601, level is one of "
+               "debug, info, warn, err, crit\n";
+        return 1;
+    }
+
+    QueryFilter filter;
+    for (int i = 2; i + 1 < args.size(); i += 2) {
+        bool valid = true;
+        if (args[i] == "--from") {
+            valid = parse_time(args[i + 1], filter.from);
+        } else if (args[i] == "--to") {
+            valid = parse_time(args[i + 1], filter.to);
+        } else if (args[i] == "--level") {
+            Level level = LEVELS_MAP.key(args[i + 1], Level::CRIT);
+            valid = LEVELS_MAP.value(level) == args[i + 1];
+            filter.level = level;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            err << "invalid argument " << args[i] << " " << args[i + 1] << "\n";
+            return 1;
+        }
+    }
+
+    QFile input(args[1]);
+    if (!input.open(QIODevice::ReadOnly)) {
+        err << "cannot open " << args[1] << "\n";
+        return 1;
+    }
+    qint64 size = input.size();
+    if (size == 0) return 0;
+    const char *data = (const char *)input.map(0, size);
+    if (data == nullptr) {
+        err << "cannot map " << args[1] << "\n";
+        return 1;
+    }
+
+    QList<LogIndexEntry> entries;
+    QFile index(args[1] + LOG_INDEX_SUFFIX);
+    if (index.open(QIODevice::ReadOnly)) {
+        QByteArray bytes = index.readAll();
+        if (bytes.startsWith(LOG_INDEX_MAGIC)) {
+            for (int pos = LOG_INDEX_MAGIC.size();
+                 pos + (int)sizeof(LogIndexEntry) <= bytes.size();
+                 pos += sizeof(LogIndexEntry)) {
+                LogIndexEntry entry;
+                memcpy(&entry, bytes.constData() + pos, sizeof(entry));
+                entries.push_back(entry);
+            }
+        }
+    }
+
+    QFile output;
+    if (!output.open(stdout, QIODevice::WriteOnly)) return 1;
+
+    LineFormat format = make_line_format(data[0] == '{');
+    qint64 covered = 0, matched = 0, skipped = 0;
+    for (const LogIndexEntry &entry : entries) {
+        qint64 end = entry.offset + entry.size;
+        if (end > size) break;
+        if ((qint64)entry.offset < covered) continue;
+        if ((qint64)entry.offset > covered) {
+            matched += scan_range(format, filter, data, covered, entry.offset,
+                                  output);
+        }
+        quint64 level_records = 0;
+        for (int level = filter.level; level < LEVEL_COUNT; ++level) {
+            level_records += entry.levels[level];
+        }
+        if (level_records > 0 && entry.last_msecs >= filter.from &&
+            entry.first_msecs - LINE_TIME_TRUNCATION_MS <= filter.to) {
+            matched +=
+                scan_range(format, filter, data, entry.offset, end, output);
+        } else {
+            skipped += entry.records;
+        }
+        covered = end;
+    }
+    matched += scan_range(format, filter, data, covered, size, output);
+    output.flush();
+    err << matched << " records matched, " << entries.size()
+        << " index blocks, " << skipped << " records skipped\n";
+    return 0;
+}